@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# Builds the benchmark executables and the stub executor of the end-to-end
+# benchmarks. The serd sources are downloaded by build.sh and
+# build_standalone.sh, run one of them first.
+
+cd "$(dirname "$0")/.."
+
+check_if_exists() {
+    local filepath=$1
+    if [ ! -f "$filepath" ]; then
+        echo "Build failed: $filepath not found."
+        exit 1
+    else
+        echo "Success."
+    fi
+}
+
+if [ ! -f ./rdf_parser/serd_lib/serd/serd.h ]; then
+    echo "Build failed: the serd sources are missing, run build_standalone.sh first."
+    exit 1
+fi
+
+echo "Building stage benchmark ..."
+rm -f ./benchmarks/stage_benchmark
+g++ -std=c++20 -Irdf_parser/serd_lib -o ./benchmarks/stage_benchmark ./benchmarks/stage_benchmark.cpp ./rdf_parser/rdf_parser.cpp ./rdf_parser/serd_lib/*.c ./rml_normalizer/rml_io_normalizer.cpp ./ra_converter/ra_converter_rml_io.cpp ./ra_converter/plan_profile.cpp ./ra_executor/plan_parser.cpp ./ra_converter/source_splitter.cpp ./ra_converter/source_statistics.cpp -O3 -pthread
+check_if_exists ./benchmarks/stage_benchmark
+echo ""
+echo "Building stub executor ..."
+rm -f ./benchmarks/libstubexecutor.so
+g++ -std=c++20 -shared -fPIC -o ./benchmarks/libstubexecutor.so ./benchmarks/stub_executor.cpp ./ra_executor/plan_parser.cpp -O3
+check_if_exists ./benchmarks/libstubexecutor.so
+echo ""
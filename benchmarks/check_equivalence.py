@@ -0,0 +1,361 @@
+import argparse
+import csv
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+BENCHMARK_DIR = os.path.dirname(os.path.abspath(__file__))
+EXECUTOR_PATH = os.path.join(os.path.dirname(BENCHMARK_DIR), "ra_execute")
+sys.path.insert(0, os.path.dirname(BENCHMARK_DIR))
+
+import rml_frontend
+from generate_mapping import MappingShape, generate
+from reference_mappings import case_directory, generate_gtfs
+
+# Checks that the optimizations of the converter do not change the generated
+# triples. Every mapping is compiled with all optimizations off, which gives
+# the reference plans, then with one optimization on at a time and with all
+# of them on. The plans of every variant are executed with the reference
+# executor (ra_execute) and their triples are compared with those of the
+# reference plans. Plans the executor rejects are reported, and only fail a
+# variant if the reference plans did not fail the same way. The summed plan
+# cost estimates are reported as well, so cost ordering, which annotates
+# them, is on in the reference plans and in every variant but its own.
+# The triples are compared as sets, so a variant that drops a needed
+# duplicate elimination, e.g. with a wrong unique key, is not caught.
+
+# Stands for the keys of the sources of a mapping in the settings
+SOURCE_KEYS = "source keys"
+
+# Optimizations as (name, settings with the optimization on, settings with it off)
+OPTIMIZATIONS = [
+    ("constant_plans", {"constant_plans": "true"}, {"constant_plans": "false"}),
+    ("push_null_filters", {"push_null_filters": "true"}, {"push_null_filters": "false"}),
+    ("early_distinct", {"early_distinct": "true"}, {"early_distinct": "false"}),
+    ("statistics", {"statistics": "true"}, {"statistics": "false"}),
+    ("join_hints", {"join_hints": "true"}, {"join_hints": "false"}),
+    ("plan_templates", {"plan_templates": "true"}, {"plan_templates": "false"}),
+    # The null filters decide which rows of a shared join reach each mapping
+    ("share_joins", {"share_joins": "true", "push_null_filters": "true"}, {"share_joins": "false"}),
+    ("late_materialization", {"late_materialization": "true"}, {"late_materialization": "false"}),
+    # Reduces every join, not only those estimated to be selective, which needs the statistics
+    ("semi_join_reduction", {"semi_join_reduction": "true", "semi_join_threshold": "1.0", "statistics": "true"},
+     {"semi_join_reduction": "false"}),
+    # Small ranges, so that the sample sources are split as well
+    ("split_size", {"split_size": "4096"}, {"split_size": "0"}),
+    ("validate_references", {"validate_references": "true"}, {"validate_references": "false"}),
+    # Declares the columns that are keys of the sources, see source_keys
+    ("unique_keys", {"unique_keys": SOURCE_KEYS}, {"unique_keys": []}),
+]
+
+# Settings that change the plans without optimizing them, each is checked on
+# its own as (name, settings) but left out of "all"
+SETTINGS = [
+    # Plans in mapping order, without the cost annotations
+    ("no_cost_ordering", {"cost_ordering": "false"}),
+]
+
+MAPPING_PREFIXES = """@prefix rr: <http://www.w3.org/ns/r2rml#> .
+@prefix rml: <http://semweb.mmlab.be/ns/rml#> .
+@prefix ql: <http://semweb.mmlab.be/ns/ql#> .
+@prefix ex: <http://example.com/> .
+"""
+
+def generate_shared_join(directory):
+    # Two child triples maps with the same join on one source, each reads a
+    # column the other one does not. A row with only one of the columns empty
+    # still yields the triple of the other triples map.
+    os.makedirs(directory, exist_ok=True)
+    with open(os.path.join(directory, "child.csv"), "w") as f:
+        f.write("id,pid,a,b\n1,K1,A1,B1\n2,K2,A2,\n3,K1,,B3\n4,,A4,B4\n5,K3,A5,B5\n")
+    with open(os.path.join(directory, "parent.csv"), "w") as f:
+        f.write("key,x\nK1,X1\nK2,X2\nK3,\n")
+
+    triples_maps = []
+    for name, column, predicate in [("A", "a", "p1"), ("B", "b", "p2")]:
+        triples_maps.append(
+            f"ex:{name} a rr:TriplesMap ;\n"
+            f"    rml:logicalSource [ rml:source \"child.csv\" ; rml:referenceFormulation ql:CSV ] ;\n"
+            f"    rr:subjectMap [ rr:template \"http://example.com/{column}/{{{column}}}\" ] ;\n"
+            f"    rr:predicateObjectMap [ rr:predicate ex:{predicate} ; rr:objectMap [ rr:parentTriplesMap ex:P ; "
+            f"rr:joinCondition [ rr:child \"pid\" ; rr:parent \"key\" ] ] ] .")
+    triples_maps.append("ex:P a rr:TriplesMap ;\n"
+                        "    rml:logicalSource [ rml:source \"parent.csv\" ; rml:referenceFormulation ql:CSV ] ;\n"
+                        "    rr:subjectMap [ rr:template \"http://example.com/x/{x}\" ] .")
+
+    mapping_path = os.path.join(directory, "mapping.ttl")
+    with open(mapping_path, "w") as f:
+        f.write(MAPPING_PREFIXES + "\n" + "\n\n".join(triples_maps) + "\n")
+    return mapping_path
+
+def generate_join_references(directory):
+    # A join with a reference subject and a graph template that contains the
+    # name of its attribute, both have to be prefixed with their source in the
+    # join output. The expected triples are written next to the mapping.
+    os.makedirs(directory, exist_ok=True)
+    with open(os.path.join(directory, "child.csv"), "w") as f:
+        f.write("id,iri,pid\n1,http://example.com/c/1,K1\n2,http://example.com/c/2,K2\n3,,K1\n")
+    with open(os.path.join(directory, "parent.csv"), "w") as f:
+        f.write("key,name\nK1,p1\nK2,\n")
+    with open(os.path.join(directory, "expected.nq"), "w") as f:
+        f.write("<http://example.com/c/1> <http://example.com/p> <http://example.com/p1> <http://example.com/id/1> .\n")
+
+    mapping_path = os.path.join(directory, "mapping.ttl")
+    with open(mapping_path, "w") as f:
+        f.write(MAPPING_PREFIXES + "\n"
+                "ex:C a rr:TriplesMap ;\n"
+                "    rml:logicalSource [ rml:source \"child.csv\" ; rml:referenceFormulation ql:CSV ] ;\n"
+                "    rr:subjectMap [ rml:reference \"iri\" ; rr:graphMap [ rr:template \"http://example.com/id/{id}\" ] ] ;\n"
+                "    rr:predicateObjectMap [ rr:predicate ex:p ; rr:objectMap [ rr:parentTriplesMap ex:P ; "
+                "rr:joinCondition [ rr:child \"pid\" ; rr:parent \"key\" ] ] ] .\n\n"
+                "ex:P a rr:TriplesMap ;\n"
+                "    rml:logicalSource [ rml:source \"parent.csv\" ; rml:referenceFormulation ql:CSV ] ;\n"
+                "    rr:subjectMap [ rr:template \"http://example.com/{name}\" ] .\n")
+    return mapping_path
+
+def generate_constant_terms(directory):
+    # Triples maps with only constant terms, over a source with rows and over
+    # one with only a header. Only the first creates its triple, once.
+    os.makedirs(directory, exist_ok=True)
+    with open(os.path.join(directory, "rows.csv"), "w") as f:
+        f.write("id\n1\n2\n3\n")
+    with open(os.path.join(directory, "empty.csv"), "w") as f:
+        f.write("id\n")
+    with open(os.path.join(directory, "expected.nq"), "w") as f:
+        f.write("<http://example.com/rows> <http://example.com/p> <http://example.com/o> .\n")
+
+    triples_maps = []
+    for name in ["rows", "empty"]:
+        triples_maps.append(
+            f"ex:{name} a rr:TriplesMap ;\n"
+            f"    rml:logicalSource [ rml:source \"{name}.csv\" ; rml:referenceFormulation ql:CSV ] ;\n"
+            f"    rr:subjectMap [ rr:constant ex:{name} ] ;\n"
+            f"    rr:predicateObjectMap [ rr:predicate ex:p ; rr:objectMap [ rr:constant ex:o ] ] .")
+
+    mapping_path = os.path.join(directory, "mapping.ttl")
+    with open(mapping_path, "w") as f:
+        f.write(MAPPING_PREFIXES + "\n" + "\n\n".join(triples_maps) + "\n")
+    return mapping_path
+
+def generate_csv_dialect(directory):
+    # A source with a UTF-8 byte order mark and semicolons between the fields,
+    # the references have to match the header names without either.
+    os.makedirs(directory, exist_ok=True)
+    with open(os.path.join(directory, "rows.csv"), "w", encoding="utf-8-sig") as f:
+        f.write("id;name\n1;a\n2;\n")
+    with open(os.path.join(directory, "expected.nq"), "w") as f:
+        f.write("<http://example.com/1> <http://example.com/name> \"a\" .\n")
+
+    mapping_path = os.path.join(directory, "mapping.ttl")
+    with open(mapping_path, "w") as f:
+        f.write(MAPPING_PREFIXES + "\n"
+                "ex:R a rr:TriplesMap ;\n"
+                "    rml:logicalSource [ rml:source \"rows.csv\" ; rml:referenceFormulation ql:CSV ] ;\n"
+                "    rr:subjectMap [ rr:template \"http://example.com/{id}\" ] ;\n"
+                "    rr:predicateObjectMap [ rr:predicate ex:name ; rr:objectMap [ rml:reference \"name\" ] ] .\n")
+    return mapping_path
+
+def source_keys(mapping_path):
+    # Returns the columns of the sources of a mapping that have a different,
+    # non-empty value in every row, as SOURCE:ATTRIBUTE
+    with open(mapping_path) as f:
+        mapping = f.read()
+    sources = re.findall(r'(?:rml:source|<http://semweb\.mmlab\.be/ns/rml#source>)\s+"([^"]*)"', mapping)
+
+    keys = []
+    for source in sorted(set(sources)):
+        path = os.path.join(os.path.dirname(os.path.abspath(mapping_path)), source)
+        if not source.endswith(".csv") or not os.path.exists(path):
+            continue
+        with open(path, newline="", encoding="utf-8-sig") as f:
+            lines = f.read().splitlines()
+        if not lines:
+            continue
+        # The delimiter the converter detects in the header
+        delimiter = next((d for d in ",;\t|" if d in lines[0]), ",")
+        rows = list(csv.reader(lines, delimiter=delimiter))
+        for c, column in enumerate(rows[0]):
+            values = [row[c] if c < len(row) else "" for row in rows[1:] if row]
+            if "" not in values and len(set(values)) == len(values):
+                keys.append(f"{source}:{column}")
+    return keys
+
+def check_cases(seeds):
+    # Returns {name: generator}, the generated shapes cover joins with missing
+    # matches, duplicate rows, empty values and graph maps. The parents of the
+    # joins carry a value column besides the key, for late materialization.
+    # Every joined triples map reads its own source, as the plans can not name
+    # the two sides of a join of a source with itself apart.
+    cases = {"GTFS-Madrid/scale=1": lambda directory: generate_gtfs(1, directory),
+             "shared join": generate_shared_join,
+             "join references": generate_join_references,
+             "constant terms": generate_constant_terms,
+             "csv dialect": generate_csv_dialect}
+    for seed in range(seeds):
+        joins = MappingShape()
+        joins.__dict__.update(triples_maps=8, poms=2, join_density=1.0, graph_maps=0.5, subject_columns=2, sources=8,
+                              rows=400, duplicates=0.2, empty=0.2, join_matches=0.5, seed=seed)
+        fanout = MappingShape()
+        fanout.__dict__.update(triples_maps=6, poms=3, fanout=2, join_density=0.3, sources=2, rows=300,
+                               duplicates=0.3, empty=0.3, seed=seed)
+        for name, shape in [("joins", joins), ("fanout", fanout)]:
+            cases[f"{name}/seed={seed}"] = lambda directory, s=shape: generate(s, directory)
+    return cases
+
+def plan_cost(plan):
+    # The cost estimate of the plan root, the annotation at the end of the plan
+    match = re.search(r"@\[([^\[\]]*)\]$", plan)
+    if match is None:
+        return 0.0
+    annotations = dict(item.partition("=")[::2] for item in match.group(1).split(","))
+    return float(annotations.get("cost", 0))
+
+def run_variant(settings, mapping_path, cache_dir, args):
+    # Compiles and executes the mapping, returns the plans, the set of quads and
+    # the errors of the plans that could not be executed
+    config = rml_frontend.Configuration()
+    config.mapping_file_path = mapping_path
+    config.cache_dir = cache_dir
+    config.plan_cache = "false"
+    config.cost_ordering = "true"
+    # The optimizations are only applied with the grammar of the reference executor
+    config.extended_grammar = "true"
+    for key, value in settings.items():
+        setattr(config, key, value)
+
+    plans = [plan for plan in rml_frontend.compile_mapping(config).splitlines() if plan]
+
+    command = [EXECUTOR_PATH, "-t", str(args.threads), "-b", config.base_uri, "--continue-on-error"]
+    result = subprocess.run(command, input="\n".join(plans) + "\n", capture_output=True, text=True)
+
+    # The plan numbers differ between the variants, only the messages are compared
+    errors = set()
+    for line in result.stderr.splitlines():
+        match = re.match(r"Error: Plan \d+: (.*)", line)
+        if match:
+            errors.add(match.group(1))
+        elif line.startswith("Error:"):
+            raise RuntimeError(line)
+    return plans, set(result.stdout.splitlines()), errors
+
+def check_case(mapping_path, cache_dir, args):
+    # Returns the number of variants whose triples differ from the reference
+    optimizations = [o for o in OPTIMIZATIONS if not args.optimization or o[0] in args.optimization]
+    all_off = {}
+    all_on = {}
+    for _, on, off in OPTIMIZATIONS:
+        all_off.update(off)
+    for _, on, _ in optimizations:
+        all_on.update(on)
+
+    variants = [(name, {**all_off, **on}) for name, on, _ in optimizations]
+    if len(optimizations) > 1:
+        variants.append(("all", all_on))
+    variants += [(name, {**all_off, **settings}) for name, settings in SETTINGS
+                 if not args.optimization or name in args.optimization]
+    keys = source_keys(mapping_path)
+    variants = [(name, {key: keys if value == SOURCE_KEYS else value for key, value in settings.items()})
+                for name, settings in variants]
+
+    reference_plans, reference_quads, reference_errors = run_variant(all_off, mapping_path, cache_dir, args)
+    reference_cost = sum(plan_cost(plan) for plan in reference_plans)
+
+    # The triples of the reference plans are checked as well if they are known,
+    # i.e. an expected.nq lies next to the mapping
+    failures = 0
+    status = ""
+    expected_path = os.path.join(os.path.dirname(os.path.abspath(mapping_path)), "expected.nq")
+    if os.path.exists(expected_path):
+        with open(expected_path) as f:
+            expected = set(f.read().splitlines())
+        missing = sorted(expected - reference_quads)
+        extra = sorted(reference_quads - expected)
+        status = "ok"
+        if missing or extra:
+            status = f"DIFFERS FROM expected.nq, {len(missing)} missing, {len(extra)} extra"
+            failures += 1
+
+    print(f"  {'none':24} {len(reference_plans):6} plans {reference_cost:14.0f} cost {'':>8} {len(reference_quads):8} triples  {status}")
+    for error in sorted(reference_errors):
+        print(f"    not executable: {error}")
+    if status not in ("", "ok"):
+        for quad in missing[:args.examples]:
+            print(f"    - {quad}")
+        for quad in extra[:args.examples]:
+            print(f"    + {quad}")
+
+    for name, settings in variants:
+        plans, quads, errors = run_variant(settings, mapping_path, cache_dir, args)
+        cost = sum(plan_cost(plan) for plan in plans)
+        # Plans without cost annotations have no cost to compare
+        change = f"{(cost - reference_cost) / reference_cost * 100:+7.1f}%" if reference_cost > 0 and cost > 0 else f"{'':>8}"
+        missing = sorted(reference_quads - quads)
+        extra = sorted(quads - reference_quads)
+        new_errors = sorted(errors - reference_errors)
+
+        status = "ok"
+        if missing or extra:
+            status = f"DIFFERS, {len(missing)} missing, {len(extra)} extra"
+        elif new_errors:
+            status = "FAILS"
+        print(f"  {name:24} {len(plans):6} plans {cost:14.0f} cost {change} {len(quads):8} triples  {status}")
+
+        if status != "ok":
+            failures += 1
+            for error in new_errors:
+                print(f"    not executable: {error}")
+            for quad in missing[:args.examples]:
+                print(f"    - {quad}")
+            for quad in extra[:args.examples]:
+                print(f"    + {quad}")
+    return failures
+
+####################################################################################################################
+
+def main():
+    parser = argparse.ArgumentParser(description="Checks that the converter optimizations do not change the triples of a mapping, using the reference executor.")
+    parser.add_argument("-m", "--mapping", type=str, action='append', default=[], help="Checks this mapping, with its sources relative to it, instead of the generated mappings.")
+    parser.add_argument("--optimization", type=str, action='append', default=[], choices=[o[0] for o in OPTIMIZATIONS + SETTINGS], help="Only checks this optimization or setting.")
+    parser.add_argument("--seeds", type=int, default=3, help="The generated mappings per shape.")
+    parser.add_argument("--examples", type=int, default=5, help="The differing triples printed per variant.")
+    parser.add_argument("-t", "--threads", type=int, default=0, help="The executor threads, 0 uses all cores.")
+    args = parser.parse_args()
+
+    if not os.path.exists(EXECUTOR_PATH):
+        print(f"Error: '{EXECUTOR_PATH}' not found, build it with build_standalone.sh")
+        sys.exit(1)
+
+    cwd = os.getcwd()
+    failures = 0
+    with tempfile.TemporaryDirectory(prefix="rml_equivalence_") as work_dir:
+        if args.mapping:
+            cases = {path: os.path.abspath(path) for path in args.mapping}
+        else:
+            cases = {}
+            for name, generator in check_cases(args.seeds).items():
+                cases[name] = generator(os.path.join(work_dir, case_directory(name)))
+
+        for i, (name, mapping_path) in enumerate(cases.items()):
+            print(name)
+            cache_dir = os.path.join(work_dir, f"cache_{i}")
+            os.makedirs(cache_dir)
+
+            # Sources are referenced relative to the mapping
+            os.chdir(os.path.dirname(mapping_path))
+            try:
+                failures += check_case(os.path.basename(mapping_path), cache_dir, args)
+            except RuntimeError as e:
+                print(f"  Error: {e}")
+                failures += 1
+            finally:
+                os.chdir(cwd)
+
+    if failures:
+        print(f"{failures} variants changed the triples")
+        sys.exit(1)
+    print("All variants generate the same triples")
+
+if __name__ == "__main__":
+    main()
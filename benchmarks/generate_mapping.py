@@ -0,0 +1,159 @@
+import argparse
+import os
+import random
+
+# Synthetic RML mappings for the frontend benchmarks. Every axis of the
+# generator stresses a different part of the frontend:
+#   triples maps   number of triples maps, scales all passes
+#   poms           predicate object maps per triples map
+#   fanout         predicates and object maps per predicate object map, which
+#                  the normalizer expands into fanout x fanout mappings
+#   join density   fraction of triples maps with a join to a parent triples map
+#   graph maps     fraction of triples maps with a graph map on the subject map
+#   prefixes       compact names instead of full IRIs, stresses the parser
+#   subject columns  columns in the subject templates, the id and the first
+#                  value columns, which joins carry besides their keys
+# and the sources, which change the statistics the converter samples:
+#   duplicates     fraction of rows repeating an earlier row
+#   empty          fraction of empty values, which generate no triples
+#   join matches   fraction of foreign keys with a matching parent row
+
+PREFIXES = {
+    "rr": "http://www.w3.org/ns/r2rml#",
+    "rml": "http://semweb.mmlab.be/ns/rml#",
+    "ql": "http://semweb.mmlab.be/ns/ql#",
+    "ex": "http://example.com/ns#",
+}
+
+class MappingShape:
+    def __init__(self):
+        self.triples_maps = 100
+        self.poms = 4
+        self.fanout = 1
+        self.join_density = 0.2
+        self.graph_maps = 0.0
+        self.prefixes = True
+        self.subject_columns = 1
+        self.sources = 10
+        self.rows = 1000
+        self.duplicates = 0.0
+        self.empty = 0.0
+        self.join_matches = 1.0
+        self.seed = 42
+
+    def as_dict(self):
+        return dict(self.__dict__)
+
+####################################################################################################################
+
+def name(shape, prefix, local):
+    # A prefixed name or the full IRI, depending on the shape
+    if shape.prefixes:
+        return f"{prefix}:{local}"
+    return f"<{PREFIXES[prefix]}{local}>"
+
+def columns(shape):
+    return ["id", "fk"] + [f"col{c}" for c in range(shape.poms * shape.fanout)]
+
+def write_sources(shape, directory):
+    rng = random.Random(shape.seed)
+    header = columns(shape)
+    for s in range(shape.sources):
+        with open(os.path.join(directory, f"source_{s}.csv"), "w") as f:
+            f.write(",".join(header) + "\n")
+            rows = []
+            for row in range(shape.rows):
+                # Only draws for the axes in use, so the default sources do not change
+                if rows and shape.duplicates > 0 and rng.random() < shape.duplicates:
+                    rows.append(rows[rng.randrange(len(rows))])
+                    continue
+
+                # Foreign keys without a match point behind the parent rows
+                fk = rng.randrange(shape.rows)
+                if shape.join_matches < 1 and rng.random() >= shape.join_matches:
+                    fk += shape.rows
+                values = [str(row), str(fk)]
+                values += ["" if shape.empty > 0 and rng.random() < shape.empty else f"v{s}_{row}_{c}" for c in range(len(header) - 2)]
+                rows.append(",".join(values))
+            f.write("\n".join(rows) + "\n")
+
+def triples_map(shape, rng, i):
+    rr = lambda local: name(shape, "rr", local)
+    rml = lambda local: name(shape, "rml", local)
+    ex = lambda local: name(shape, "ex", local)
+
+    lines = [f"{ex(f'TriplesMap{i}')} a {rr('TriplesMap')} ;"]
+    lines.append(f"    {rml('logicalSource')} [ {rml('source')} \"source_{i % shape.sources}.csv\" ; "
+                 f"{rml('referenceFormulation')} {name(shape, 'ql', 'CSV')} ] ;")
+
+    subject = "http://example.com/entity" + str(i) + "".join(f"/{{{column}}}" for column in columns(shape)[:1] + columns(shape)[2:shape.subject_columns + 1])
+    subject_map = [f"{rr('template')} \"{subject}\"", f"{rr('class')} {ex(f'Class{i}')}"]
+    if rng.random() < shape.graph_maps:
+        subject_map.append(f"{rr('graphMap')} [ {rr('template')} \"http://example.com/graph{i % 3}/{{fk}}\" ]")
+    lines.append(f"    {rr('subjectMap')} [ {' ; '.join(subject_map)} ] ;")
+
+    column = 0
+    for p in range(shape.poms):
+        parts = []
+        for f in range(shape.fanout):
+            parts.append(f"{rr('predicate')} {ex(f'p{i}_{p}_{f}')}")
+        for f in range(shape.fanout):
+            parts.append(f"{rr('objectMap')} [ {rml('reference')} \"col{column}\" ]")
+            column += 1
+        lines.append(f"    {rr('predicateObjectMap')} [ {' ; '.join(parts)} ] ;")
+
+    if i > 0 and rng.random() < shape.join_density:
+        parent = rng.randrange(i)
+        lines.append(f"    {rr('predicateObjectMap')} [ {rr('predicate')} {ex(f'link{i}')} ; "
+                     f"{rr('objectMap')} [ {rr('parentTriplesMap')} {ex(f'TriplesMap{parent}')} ; "
+                     f"{rr('joinCondition')} [ {rr('child')} \"fk\" ; {rr('parent')} \"id\" ] ] ] ;")
+
+    lines[-1] = lines[-1][:-2] + " ."
+    return "\n".join(lines)
+
+def generate(shape, directory):
+    # Writes mapping.ttl and its CSV sources into the directory, returns the mapping path
+    os.makedirs(directory, exist_ok=True)
+    rng = random.Random(shape.seed)
+
+    parts = []
+    if shape.prefixes:
+        parts.append("\n".join(f"@prefix {prefix}: <{iri}> ." for prefix, iri in PREFIXES.items()))
+    for i in range(shape.triples_maps):
+        parts.append(triples_map(shape, rng, i))
+
+    mapping_path = os.path.join(directory, "mapping.ttl")
+    with open(mapping_path, "w") as f:
+        f.write("\n\n".join(parts) + "\n")
+
+    write_sources(shape, directory)
+    return mapping_path
+
+####################################################################################################################
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates a synthetic RML mapping and its CSV sources.")
+    parser.add_argument("-o", "--output-dir", type=str, required=True, help="The directory the mapping and sources are written to.")
+    parser.add_argument("--triples-maps", type=int, default=100, help="The number of triples maps.")
+    parser.add_argument("--poms", type=int, default=4, help="The predicate object maps per triples map.")
+    parser.add_argument("--fanout", type=int, default=1, help="The predicates and object maps per predicate object map.")
+    parser.add_argument("--join-density", type=float, default=0.2, help="The fraction of triples maps joined with a parent triples map.")
+    parser.add_argument("--graph-maps", type=float, default=0.0, help="The fraction of triples maps with a graph map.")
+    parser.add_argument("--no-prefixes", action='store_false', dest="prefixes", help="Writes full IRIs instead of prefixed names.")
+    parser.add_argument("--subject-columns", type=int, default=1, help="The columns in the subject templates, the id and the first value columns.")
+    parser.add_argument("--sources", type=int, default=10, help="The number of CSV sources shared by the triples maps.")
+    parser.add_argument("--rows", type=int, default=1000, help="The rows per CSV source.")
+    parser.add_argument("--duplicates", type=float, default=0.0, help="The fraction of rows repeating an earlier row.")
+    parser.add_argument("--empty", type=float, default=0.0, help="The fraction of empty values.")
+    parser.add_argument("--join-matches", type=float, default=1.0, help="The fraction of foreign keys with a matching parent row.")
+    parser.add_argument("--seed", type=int, default=42, help="The seed of the random choices.")
+    args = parser.parse_args()
+
+    shape = MappingShape()
+    for key in shape.as_dict():
+        setattr(shape, key, getattr(args, key))
+
+    print(generate(shape, args.output_dir))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,297 @@
+import argparse
+import os
+import random
+
+from generate_mapping import MappingShape, generate
+
+# Reference mappings for the end-to-end benchmarks, shaped like the test case
+# groups of the benchmark chart in the README:
+#   GTFS-Madrid        a GTFS feed mapping with 13 triples maps and joins between the feed files
+#   duplicated values  one triples map over a source with repeated rows
+#   empty values       one triples map over a source with empty values
+#   joins              a child and a parent triples map with a varying fraction of matching keys
+#   mappings           the same predicate object maps spread over more triples maps
+#   properties         one triples map with a growing number of predicate object maps
+#   records            one triples map over a growing source
+# Every case writes mapping.ttl and its CSV sources into a directory.
+
+PREFIXES = """@prefix rr: <http://www.w3.org/ns/r2rml#> .
+@prefix rml: <http://semweb.mmlab.be/ns/rml#> .
+@prefix ql: <http://semweb.mmlab.be/ns/ql#> .
+@prefix xsd: <http://www.w3.org/2001/XMLSchema#> .
+@prefix gtfs: <http://vocab.gtfs.org/terms#> .
+@prefix geo: <http://www.w3.org/2003/01/geo/wgs84_pos#> .
+@prefix dct: <http://purl.org/dc/terms/> .
+@prefix foaf: <http://xmlns.com/foaf/0.1/> .
+@prefix schema: <http://schema.org/> .
+@prefix ex: <http://transport.linkeddata.es/madrid/metro/> .
+"""
+
+####################################################################################################################
+####### GTFS-Madrid
+####################################################################################################################
+
+# Columns of the feed files, in file order
+GTFS_FILES = {
+    "AGENCY": ["agency_id", "agency_name", "agency_url", "agency_timezone", "agency_lang", "agency_phone",
+               "agency_fare_url"],
+    "ROUTES": ["route_id", "agency_id", "route_short_name", "route_long_name", "route_desc", "route_type",
+               "route_url", "route_color", "route_text_color"],
+    "TRIPS": ["route_id", "service_id", "trip_id", "trip_headsign", "trip_short_name", "direction_id", "block_id",
+              "shape_id", "wheelchair_accessible"],
+    "STOPS": ["stop_id", "stop_code", "stop_name", "stop_desc", "stop_lat", "stop_lon", "zone_id", "stop_url",
+              "location_type", "parent_station", "stop_timezone", "wheelchair_boarding"],
+    "STOP_TIMES": ["trip_id", "arrival_time", "departure_time", "stop_id", "stop_sequence", "stop_headsign",
+                   "pickup_type", "drop_off_type", "shape_dist_traveled"],
+    "CALENDAR": ["service_id", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday",
+                 "start_date", "end_date"],
+    "CALENDAR_DATES": ["service_id", "date", "exception_type"],
+    "FEED_INFO": ["feed_publisher_name", "feed_publisher_url", "feed_lang", "feed_start_date", "feed_end_date",
+                  "feed_version"],
+    "SHAPES": ["shape_id", "shape_pt_lat", "shape_pt_lon", "shape_pt_sequence", "shape_dist_traveled"],
+    "FREQUENCIES": ["trip_id", "start_time", "end_time", "headway_secs", "exact_times"],
+}
+
+def gtfs_time(rng):
+    return f"{rng.randrange(5, 24):02}:{rng.randrange(60):02}:{rng.randrange(60):02}"
+
+def gtfs_rows(name, scale, rng):
+    # Row counts roughly follow the ratios of the Madrid metro feed, stop times dominate
+    routes = max(1, 10 * scale)
+    trips = max(1, 200 * scale)
+    stops = max(1, 100 * scale)
+    services = max(1, 5 * scale)
+    shapes = max(1, 20 * scale)
+
+    if name == "AGENCY":
+        return [["metro", "Metro de Madrid", "http://www.metromadrid.es", "Europe/Madrid", "es", "902444403",
+                 "http://www.metromadrid.es/fares"]]
+    if name == "ROUTES":
+        return [[f"R{r}", "metro", f"L{r}", f"Line {r}", f"Route {r}", "1", f"http://www.metromadrid.es/line/{r}",
+                 "FF0000", "FFFFFF"] for r in range(routes)]
+    if name == "TRIPS":
+        return [[f"R{rng.randrange(routes)}", f"S{rng.randrange(services)}", f"T{t}", f"Headsign {t}", f"{t}",
+                 str(t % 2), f"B{t % 7}", f"SH{rng.randrange(shapes)}", str(rng.randrange(3))] for t in range(trips)]
+    if name == "STOPS":
+        # Every tenth stop is a station, the other stops are platforms of a station
+        return [[f"P{s}", f"{s}", f"Stop {s}", f"Platform {s}", f"{40.3 + rng.random() / 5:.6f}",
+                 f"{-3.8 + rng.random() / 5:.6f}", f"Z{s % 3}", f"http://www.metromadrid.es/stop/{s}",
+                 "1" if s % 10 == 0 else "0", "" if s % 10 == 0 else f"P{s - s % 10}", "Europe/Madrid",
+                 str(rng.randrange(3))] for s in range(stops)]
+    if name == "STOP_TIMES":
+        rows = []
+        for t in range(trips):
+            for sequence in range(20):
+                time = gtfs_time(rng)
+                rows.append([f"T{t}", time, time, f"P{rng.randrange(stops)}", str(sequence), "", "0", "0",
+                             str(sequence * 850)])
+        return rows
+    if name == "CALENDAR":
+        return [[f"S{s}"] + [str(rng.randrange(2)) for _ in range(7)] + ["2017-01-01", "2017-12-31"]
+                for s in range(services)]
+    if name == "CALENDAR_DATES":
+        return [[f"S{rng.randrange(services)}", f"2017-{rng.randrange(1, 13):02}-{rng.randrange(1, 29):02}",
+                 str(rng.randrange(1, 3))] for _ in range(4 * services)]
+    if name == "FEED_INFO":
+        return [["Consorcio Regional de Transportes de Madrid", "http://www.crtm.es", "es", "2017-01-01",
+                 "2017-12-31", "1.0"]]
+    if name == "SHAPES":
+        return [[f"SH{s}", f"{40.3 + rng.random() / 5:.6f}", f"{-3.8 + rng.random() / 5:.6f}", str(p), str(p * 100)]
+                for s in range(shapes) for p in range(50)]
+    if name == "FREQUENCIES":
+        return [[f"T{rng.randrange(trips)}", gtfs_time(rng), gtfs_time(rng), "300", "0"] for _ in range(trips // 4 + 1)]
+    raise ValueError(name)
+
+def gtfs_triples_map(name, source, subject, cls, properties, joins=()):
+    # properties: (predicate, object map), joins: (predicate, parent map, child, parent)
+    lines = [f"ex:{name} a rr:TriplesMap ;",
+             f"    rml:logicalSource [ rml:source \"{source}.csv\" ; rml:referenceFormulation ql:CSV ] ;",
+             f"    rr:subjectMap [ rr:template \"http://transport.linkeddata.es/madrid/metro/{subject}\" ; rr:class {cls} ] ;"]
+    for predicate, object_map in properties:
+        lines.append(f"    rr:predicateObjectMap [ rr:predicate {predicate} ; rr:objectMap [ {object_map} ] ] ;")
+    for predicate, parent, child, parent_key in joins:
+        lines.append(f"    rr:predicateObjectMap [ rr:predicate {predicate} ; rr:objectMap [ rr:parentTriplesMap ex:{parent} ; "
+                     f"rr:joinCondition [ rr:child \"{child}\" ; rr:parent \"{parent_key}\" ] ] ] ;")
+    lines[-1] = lines[-1][:-2] + " ."
+    return "\n".join(lines)
+
+def reference(column, datatype=None):
+    return f"rml:reference \"{column}\"" + (f" ; rr:datatype xsd:{datatype}" if datatype else "")
+
+def iri_reference(column):
+    return f"rml:reference \"{column}\" ; rr:termType rr:IRI"
+
+def template(value):
+    return f"rr:template \"http://transport.linkeddata.es/madrid/metro/{value}\""
+
+GTFS_TRIPLES_MAPS = [
+    gtfs_triples_map("stoptimes", "STOP_TIMES", "stoptimes/{trip_id}-{stop_id}-{arrival_time}", "gtfs:StopTime", [
+        ("gtfs:arrivalTime", reference("arrival_time", "duration")),
+        ("gtfs:departureTime", reference("departure_time", "duration")),
+        ("gtfs:stopSequence", reference("stop_sequence", "integer")),
+        ("gtfs:headsign", reference("stop_headsign")),
+        ("gtfs:pickupType", template("pickupType/{pickup_type}")),
+        ("gtfs:dropOffType", template("dropOffType/{drop_off_type}")),
+        ("gtfs:distanceTraveled", reference("shape_dist_traveled", "double")),
+    ], [("gtfs:trip", "trips", "trip_id", "trip_id"), ("gtfs:stop", "stops", "stop_id", "stop_id")]),
+    gtfs_triples_map("trips", "TRIPS", "trips/{trip_id}", "gtfs:Trip", [
+        ("gtfs:service", template("services/{service_id}")),
+        ("gtfs:headsign", reference("trip_headsign")),
+        ("gtfs:shortName", reference("trip_short_name")),
+        ("gtfs:direction", reference("direction_id")),
+        ("gtfs:block", reference("block_id")),
+        ("gtfs:shape", template("shape/{shape_id}")),
+        ("gtfs:wheelchairAccessible", template("wheelchairStatus/{wheelchair_accessible}")),
+    ], [("gtfs:route", "routes", "route_id", "route_id")]),
+    gtfs_triples_map("routes", "ROUTES", "routes/{route_id}", "gtfs:Route", [
+        ("gtfs:shortName", reference("route_short_name")),
+        ("gtfs:longName", reference("route_long_name")),
+        ("dct:description", reference("route_desc")),
+        ("gtfs:routeType", template("routeType/{route_type}")),
+        ("gtfs:routeUrl", iri_reference("route_url")),
+        ("gtfs:color", reference("route_color")),
+        ("gtfs:textColor", reference("route_text_color")),
+    ], [("gtfs:agency", "agency", "agency_id", "agency_id")]),
+    gtfs_triples_map("agency", "AGENCY", "agency/{agency_id}", "gtfs:Agency", [
+        ("foaf:page", iri_reference("agency_url")),
+        ("foaf:name", reference("agency_name")),
+        ("gtfs:timeZone", reference("agency_timezone")),
+        ("dct:language", reference("agency_lang")),
+        ("foaf:phone", reference("agency_phone")),
+        ("gtfs:fareUrl", iri_reference("agency_fare_url")),
+    ]),
+    gtfs_triples_map("stops", "STOPS", "stops/{stop_id}", "gtfs:Stop", [
+        ("gtfs:code", reference("stop_code")),
+        ("dct:identifier", reference("stop_id")),
+        ("foaf:name", reference("stop_name")),
+        ("dct:description", reference("stop_desc")),
+        ("geo:lat", reference("stop_lat", "double")),
+        ("geo:long", reference("stop_lon", "double")),
+        ("gtfs:zone", reference("zone_id")),
+        ("foaf:page", iri_reference("stop_url")),
+        ("gtfs:locationType", template("locationType/{location_type}")),
+        ("gtfs:timeZone", reference("stop_timezone")),
+        ("gtfs:wheelchairAccessible", template("wheelchairStatus/{wheelchair_boarding}")),
+    ], [("gtfs:parentStation", "stops", "parent_station", "stop_id")]),
+    gtfs_triples_map("services1", "CALENDAR", "services/{service_id}", "gtfs:Service", [
+        ("gtfs:serviceRule", template("calendar_rules/{service_id}")),
+    ]),
+    gtfs_triples_map("services2", "CALENDAR_DATES", "services/{service_id}", "gtfs:Service", [
+        ("gtfs:serviceRule", template("calendar_date_rule/{service_id}-{date}")),
+    ]),
+    gtfs_triples_map("calendar_date_rules", "CALENDAR_DATES", "calendar_date_rule/{service_id}-{date}",
+                     "gtfs:CalendarDateRule", [
+        ("dct:date", reference("date", "date")),
+        ("gtfs:dateAddition", reference("exception_type", "boolean")),
+    ]),
+    gtfs_triples_map("calendar_rules", "CALENDAR", "calendar_rules/{service_id}", "gtfs:CalendarRule", [
+        (f"gtfs:{day}", reference(day, "boolean"))
+        for day in ["monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"]
+    ] + [
+        ("schema:startDate", reference("start_date", "date")),
+        ("schema:endDate", reference("end_date", "date")),
+    ]),
+    gtfs_triples_map("feed", "FEED_INFO", "feed/{feed_publisher_name}", "gtfs:Feed", [
+        ("dct:publisher", reference("feed_publisher_name")),
+        ("foaf:page", iri_reference("feed_publisher_url")),
+        ("dct:language", reference("feed_lang")),
+        ("schema:startDate", reference("feed_start_date", "date")),
+        ("schema:endDate", reference("feed_end_date", "date")),
+        ("schema:version", reference("feed_version")),
+    ]),
+    gtfs_triples_map("shapes", "SHAPES", "shape/{shape_id}", "gtfs:Shape", [
+        ("gtfs:shapePoint", template("shape_point/{shape_id}-{shape_pt_sequence}")),
+    ]),
+    gtfs_triples_map("shapePoints", "SHAPES", "shape_point/{shape_id}-{shape_pt_sequence}", "gtfs:ShapePoint", [
+        ("geo:lat", reference("shape_pt_lat", "double")),
+        ("geo:long", reference("shape_pt_lon", "double")),
+        ("gtfs:pointSequence", reference("shape_pt_sequence", "integer")),
+        ("gtfs:distanceTraveled", reference("shape_dist_traveled", "double")),
+    ]),
+    gtfs_triples_map("frequencies", "FREQUENCIES", "frequency/{trip_id}-{start_time}", "gtfs:Frequency", [
+        ("gtfs:startTime", reference("start_time")),
+        ("gtfs:endTime", reference("end_time")),
+        ("gtfs:headwaySeconds", reference("headway_secs", "integer")),
+        ("gtfs:exactTimes", reference("exact_times", "boolean")),
+    ], [("gtfs:trip", "trips", "trip_id", "trip_id")]),
+]
+
+def generate_gtfs(scale, directory):
+    # Writes the GTFS mapping and a feed with scale times the base row counts, returns the mapping path
+    os.makedirs(directory, exist_ok=True)
+    rng = random.Random(42)
+    for name, columns in GTFS_FILES.items():
+        with open(os.path.join(directory, f"{name}.csv"), "w") as f:
+            f.write(",".join(columns) + "\n")
+            for row in gtfs_rows(name, scale, rng):
+                f.write(",".join(row) + "\n")
+
+    mapping_path = os.path.join(directory, "mapping.ttl")
+    with open(mapping_path, "w") as f:
+        f.write(PREFIXES + "\n" + "\n\n".join(GTFS_TRIPLES_MAPS) + "\n")
+    return mapping_path
+
+####################################################################################################################
+####### Scaling groups
+####################################################################################################################
+
+def shape(**values):
+    # A single source, as the scaling test cases read one file per triples map
+    result = MappingShape()
+    result.triples_maps = 1
+    result.poms = 10
+    result.join_density = 0.0
+    result.sources = 1
+    result.rows = 100000
+    for key, value in values.items():
+        setattr(result, key, value)
+    return result
+
+def reference_cases(quick):
+    # Returns the cases as {name: (group, parameters, generator)}, quick runs use fewer rows
+    scale = 10 if quick else 1
+    rows = 100000 // scale
+
+    cases = {}
+    for gtfs_scale in [1, 10] if quick else [1, 10, 100]:
+        cases[f"GTFS-Madrid/scale={gtfs_scale}"] = (
+            "GTFS-Madrid", {"scale": gtfs_scale}, lambda directory, s=gtfs_scale: generate_gtfs(s, directory))
+
+    groups = [
+        ("duplicated values", "duplicates", [0.0, 0.25, 0.5, 0.75, 1.0], {}),
+        ("empty values", "empty", [0.0, 0.25, 0.5, 0.75, 1.0], {}),
+        ("joins", "join_matches", [0.0, 0.25, 0.5, 0.75, 1.0], {"triples_maps": 2, "join_density": 1.0, "poms": 5, "sources": 2}),
+        ("mappings", "triples_maps", [1, 3, 5, 15], {}),
+        ("properties", "poms", [1, 10, 20, 30], {}),
+        ("records", "rows", [10000 // scale, 100000 // scale, 1000000 // scale], {}),
+    ]
+    for group, axis, values, fixed in groups:
+        for value in values:
+            values_of_case = {"rows": rows, **fixed, axis: value}
+            if axis == "triples_maps":
+                # 15 predicate object maps in total, as 1x15, 3x5, 5x3 and 15x1
+                values_of_case["poms"] = 15 // value
+            case_shape = shape(**values_of_case)
+            cases[f"{group}/{axis}={value}"] = (
+                group, case_shape.as_dict(), lambda directory, s=case_shape: generate(s, directory))
+    return cases
+
+def case_directory(name):
+    return name.replace("/", "_").replace("=", "_").replace(" ", "_")
+
+####################################################################################################################
+
+def main():
+    parser = argparse.ArgumentParser(description="Writes the reference mappings of the end-to-end benchmarks and their sources.")
+    parser.add_argument("-o", "--output-dir", type=str, required=True, help="The directory the cases are written to, one subdirectory per case.")
+    parser.add_argument("--quick", action='store_true', help="Uses smaller sources.")
+    parser.add_argument("--case", type=str, action='append', default=[], help="Only writes the cases whose name contains this text.")
+    args = parser.parse_args()
+
+    for name, (group, parameters, generator) in reference_cases(args.quick).items():
+        if args.case and not any(pattern in name for pattern in args.case):
+            continue
+        print(generator(os.path.join(args.output_dir, case_directory(name))))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,158 @@
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+from generate_mapping import MappingShape, generate
+
+# Runs the stage benchmark on synthetic mappings that vary one axis of the
+# generator at a time, writes the results as JSON and compares them with the
+# results of a baseline run.
+
+BENCHMARK_DIR = os.path.dirname(os.path.abspath(__file__))
+
+def benchmark_cases(quick):
+    # The base shape and the variations of every axis, quick runs use smaller mappings
+    scale = 4 if quick else 1
+    base = MappingShape()
+    base.triples_maps = 200 // scale
+
+    variations = [
+        ("triples_maps", [100 // scale, 400 // scale, 800 // scale]),
+        ("poms", [1, 8, 16]),
+        ("fanout", [2, 3]),
+        ("join_density", [0.0, 0.5, 1.0]),
+        ("graph_maps", [0.5, 1.0]),
+        ("prefixes", [False]),
+    ]
+
+    cases = {"base": base}
+    for axis, values in variations:
+        for value in values:
+            shape = MappingShape()
+            shape.__dict__.update(base.as_dict())
+            setattr(shape, axis, value)
+            cases[f"{axis}={value}"] = shape
+    return cases
+
+def run_case(binary, shape, directory, repetitions, threads, options):
+    mapping_path = generate(shape, directory)
+    command = [binary, "-r", str(repetitions), "-t", str(threads)]
+    for option in options:
+        command += ["-o", option]
+    command.append(os.path.basename(mapping_path))
+
+    # Sources are referenced relative to the mapping
+    result = subprocess.run(command, cwd=directory, capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"{' '.join(command)} failed: {result.stderr.strip()}")
+    return json.loads(result.stdout)
+
+def run_benchmarks(args):
+    results = {
+        "version": 1,
+        "created": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "host": platform.node(),
+        "repetitions": args.repetitions,
+        "threads": args.threads,
+        "options": args.option,
+        "cases": {},
+    }
+
+    with tempfile.TemporaryDirectory(prefix="rml_benchmark_") as work_dir:
+        for name, shape in benchmark_cases(args.quick).items():
+            if args.case and not any(pattern in name for pattern in args.case):
+                continue
+
+            directory = os.path.join(work_dir, name.replace("=", "_"))
+            measurement = run_case(args.binary, shape, directory, args.repetitions, args.threads, args.option)
+            results["cases"][name] = {
+                "shape": shape.as_dict(),
+                "counts": measurement["counts"],
+                "stages": measurement["stages"],
+            }
+
+            total = sum(stage["median_ms"] for stage in measurement["stages"].values())
+            print(f"{name:24} {measurement['counts']['sub_graphs']:7} subgraphs {total:10.1f} ms", file=sys.stderr)
+
+    return results
+
+####################################################################################################################
+
+def compare(results, baseline, threshold, min_ms):
+    # Prints the median of every stage against the baseline and returns the regressions,
+    # i.e. stages slower by more than the threshold factor and min_ms
+    regressions = []
+    print(f"{'case':24} {'stage':32} {'baseline ms':>12} {'current ms':>12} {'ratio':>7}")
+    for name, case in results["cases"].items():
+        baseline_case = baseline["cases"].get(name)
+        if baseline_case is None:
+            continue
+        if baseline_case["shape"] != case["shape"]:
+            print(f"{name:24} skipped, the mapping shape changed")
+            continue
+
+        for stage, timing in case["stages"].items():
+            baseline_timing = baseline_case["stages"].get(stage)
+            if baseline_timing is None:
+                continue
+
+            current_ms = timing["median_ms"]
+            baseline_ms = baseline_timing["median_ms"]
+            ratio = current_ms / baseline_ms if baseline_ms > 0 else float("inf")
+            regressed = ratio > threshold and current_ms - baseline_ms > min_ms
+            marker = "  REGRESSION" if regressed else ""
+            print(f"{name:24} {stage:32} {baseline_ms:12.2f} {current_ms:12.2f} {ratio:7.2f}{marker}")
+            if regressed:
+                regressions.append((name, stage, ratio))
+
+    return regressions
+
+####################################################################################################################
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-stage benchmarks of the frontend on synthetic mappings.")
+    parser.add_argument("-o", "--output", type=str, required=False, help="The path where the results are stored as JSON.")
+    parser.add_argument("-b", "--baseline", type=str, required=False, help="Compares the results with those of a baseline run.")
+    parser.add_argument("--compare", type=str, required=False, help="Compares these stored results with the baseline instead of running the benchmarks.")
+    parser.add_argument("--threshold", type=float, default=1.25, help="The factor a stage may be slower than in the baseline.")
+    parser.add_argument("--min-ms", type=float, default=1.0, help="The milliseconds a stage may be slower than in the baseline regardless of the factor.")
+    parser.add_argument("--quick", action='store_true', help="Uses smaller mappings.")
+    parser.add_argument("--case", type=str, action='append', default=[], help="Only runs the cases whose name contains this text.")
+    parser.add_argument("-r", "--repetitions", type=int, default=5, help="The runs of every stage per case.")
+    parser.add_argument("-t", "--threads", type=int, default=1, help="The converter threads, 0 uses all cores.")
+    parser.add_argument("--option", type=str, action='append', default=[], metavar="KEY=VALUE", help="A converter option.")
+    parser.add_argument("--binary", type=str, default=os.path.join(BENCHMARK_DIR, "stage_benchmark"), help="The stage benchmark executable.")
+    args = parser.parse_args()
+
+    if args.compare:
+        if not args.baseline:
+            parser.error("--compare requires --baseline")
+        with open(args.compare) as f:
+            results = json.load(f)
+    else:
+        if not os.path.exists(args.binary):
+            print(f"Error: '{args.binary}' not found, build it with benchmarks/build_benchmarks.sh")
+            sys.exit(1)
+        results = run_benchmarks(args)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+    elif not args.baseline:
+        print(json.dumps(results, indent=2))
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, args.threshold, args.min_ms)
+        if regressions:
+            print(f"{len(regressions)} stages regressed by more than {args.threshold}x")
+            sys.exit(1)
+
+if __name__ == "__main__":
+    main()
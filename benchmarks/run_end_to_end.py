@@ -0,0 +1,192 @@
+import argparse
+import json
+import os
+import platform
+import queue
+import statistics
+import sys
+import tempfile
+import threading
+import time
+
+BENCHMARK_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.dirname(BENCHMARK_DIR))
+
+# The stub replaces the konverter backend, it must be installed before the frontend is imported
+import stub_konverter
+stub_konverter.install()
+
+import rml_frontend
+from reference_mappings import case_directory, reference_cases
+from run_benchmarks import compare
+
+# Runs the frontend end to end on the reference mappings, with the plans handed
+# to the stub executor instead of the konverter backend. For every case it
+# measures the compile latency of the first and of later compilations, the
+# latency of the first streamed plans, the size of the plans and the handoff,
+# i.e. passing the plans to the executor, which parses and validates them.
+
+def summary(samples):
+    return {
+        "min_ms": min(samples) * 1000,
+        "median_ms": statistics.median(samples) * 1000,
+        "mean_ms": statistics.mean(samples) * 1000,
+    }
+
+def configuration(directory, args):
+    config = rml_frontend.Configuration()
+    config.mapping_file_path = "mapping.ttl"
+    config.cache_dir = os.path.join(directory, "cache")
+    config.plan_cache = "false"
+    if args.no_threading:
+        config.threading_enabled = "false"
+    for option in args.option:
+        key, _, value = option.partition("=")
+        setattr(config, key, value)
+    return config
+
+def stream(config):
+    # Returns the seconds until the first plans arrived and until the compilation finished
+    plan_queue = queue.Queue()
+    start_time = time.perf_counter()
+    compiler = threading.Thread(target=rml_frontend.stream_plans, args=(config, plan_queue), daemon=True)
+    compiler.start()
+
+    first_plan = None
+    while (plans := plan_queue.get()) is not None:
+        if plans.startswith("Error:"):
+            raise RuntimeError(plans.strip())
+        if first_plan is None:
+            first_plan = time.perf_counter() - start_time
+    total = time.perf_counter() - start_time
+    compiler.join()
+    return first_plan if first_plan is not None else total, total
+
+def run_case(directory, args):
+    config = configuration(directory, args)
+
+    # The first compilation samples the sources, later ones reuse the statistics
+    start_time = time.perf_counter()
+    ra_str = rml_frontend.compile_mapping(config)
+    compile_cold = time.perf_counter() - start_time
+
+    compile_times = []
+    for _ in range(args.repetitions):
+        start_time = time.perf_counter()
+        ra_str = rml_frontend.compile_mapping(config)
+        compile_times.append(time.perf_counter() - start_time)
+
+    first_plan_times = []
+    stream_times = []
+    for _ in range(args.repetitions):
+        first_plan, total = stream(config)
+        first_plan_times.append(first_plan)
+        stream_times.append(total)
+
+    handoffs = []
+    for _ in range(args.repetitions):
+        stub_konverter.run_converter(ra_str, config.base_uri, config.continue_on_error, config.threading_enabled,
+                                     config.materialize_constants, config.heuristic_ordering)
+        handoffs.append(stub_konverter.handoffs[-1])
+
+    source_bytes = sum(os.path.getsize(entry.path) for entry in os.scandir(directory) if entry.name.endswith(".csv"))
+    return {
+        "counts": {
+            "source_bytes": source_bytes,
+            "plans": handoffs[-1]["plans"],
+            "operators": handoffs[-1]["operators"],
+            "plan_bytes": handoffs[-1]["bytes"],
+        },
+        "stages": {
+            "compile_cold": summary([compile_cold]),
+            "compile": summary(compile_times),
+            "stream_first_plan": summary(first_plan_times),
+            "stream": summary(stream_times),
+            "handoff": summary([handoff["seconds"] for handoff in handoffs]),
+        },
+    }
+
+def run_benchmarks(args):
+    results = {
+        "version": 1,
+        "created": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "host": platform.node(),
+        "repetitions": args.repetitions,
+        "threading": not args.no_threading,
+        "options": args.option,
+        "cases": {},
+    }
+
+    cwd = os.getcwd()
+    with tempfile.TemporaryDirectory(prefix="rml_end_to_end_") as work_dir:
+        for name, (group, parameters, generator) in reference_cases(args.quick).items():
+            if args.case and not any(pattern in name for pattern in args.case):
+                continue
+
+            directory = os.path.join(work_dir, case_directory(name))
+            generator(directory)
+
+            # Sources are referenced relative to the mapping
+            os.chdir(directory)
+            try:
+                measurement = run_case(directory, args)
+            finally:
+                os.chdir(cwd)
+
+            results["cases"][name] = {"group": group, "shape": parameters, **measurement}
+            counts = measurement["counts"]
+            stages = measurement["stages"]
+            print(f"{name:36} {counts['plans']:6} plans {counts['plan_bytes'] / 1024:9.1f} KiB "
+                  f"compile {stages['compile_cold']['median_ms']:9.1f} / {stages['compile']['median_ms']:9.1f} ms "
+                  f"first plan {stages['stream_first_plan']['median_ms']:8.1f} ms "
+                  f"handoff {stages['handoff']['median_ms']:7.2f} ms", file=sys.stderr)
+
+    return results
+
+####################################################################################################################
+
+def main():
+    parser = argparse.ArgumentParser(description="End-to-end benchmarks of the frontend on the reference mappings, with a stub executor.")
+    parser.add_argument("-o", "--output", type=str, required=False, help="The path where the results are stored as JSON.")
+    parser.add_argument("-b", "--baseline", type=str, required=False, help="Compares the results with those of a baseline run.")
+    parser.add_argument("--compare", type=str, required=False, help="Compares these stored results with the baseline instead of running the benchmarks.")
+    parser.add_argument("--threshold", type=float, default=1.25, help="The factor a stage may be slower than in the baseline.")
+    parser.add_argument("--min-ms", type=float, default=5.0, help="The milliseconds a stage may be slower than in the baseline regardless of the factor.")
+    parser.add_argument("--quick", action='store_true', help="Uses smaller sources.")
+    parser.add_argument("--case", type=str, action='append', default=[], help="Only runs the cases whose name contains this text.")
+    parser.add_argument("-r", "--repetitions", type=int, default=5, help="The compilations and handoffs per case.")
+    parser.add_argument("--no-threading", action='store_true', help="Compiles with a single thread.")
+    parser.add_argument("--option", type=str, action='append', default=[], metavar="KEY=VALUE", help="A frontend configuration value, e.g. share_joins=false.")
+    args = parser.parse_args()
+
+    for option in args.option:
+        if "=" not in option or not hasattr(rml_frontend.Configuration(), option.partition("=")[0]):
+            parser.error(f"unknown frontend option '{option}'")
+
+    if args.compare:
+        if not args.baseline:
+            parser.error("--compare requires --baseline")
+        with open(args.compare) as f:
+            results = json.load(f)
+    else:
+        if not os.path.exists(stub_konverter.LIB_PATH):
+            print(f"Error: '{stub_konverter.LIB_PATH}' not found, build it with benchmarks/build_benchmarks.sh")
+            sys.exit(1)
+        results = run_benchmarks(args)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+    elif not args.baseline:
+        print(json.dumps(results, indent=2))
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, args.threshold, args.min_ms)
+        if regressions:
+            print(f"{len(regressions)} stages regressed by more than {args.threshold}x")
+            sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../ra_converter/ra_converter_rml_io.h"
+#include "../rdf_parser/rdf_parser.h"
+#include "../rml_normalizer/rml_io_normalizer.h"
+
+// Times every stage of the frontend on one mapping and prints the results as a
+// JSON object. All stages run on the output of the previous stage, exactly as
+// normalize_mapping and compile_mapping chain them.
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Timing
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Samples of every stage in milliseconds, in stage order
+class StageTimes {
+ private:
+  std::vector<std::pair<std::string, std::vector<double>>> stages;
+
+ public:
+  template <typename Function>
+  auto time(const std::string& stage, Function&& function) {
+    auto start_time = std::chrono::steady_clock::now();
+    auto finish = [&]() {
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+      auto it = std::find_if(stages.begin(), stages.end(), [&](const auto& entry) { return entry.first == stage; });
+      if (it == stages.end()) {
+        stages.push_back({stage, {ms}});
+      } else {
+        it->second.push_back(ms);
+      }
+    };
+
+    if constexpr (std::is_void_v<decltype(function())>) {
+      function();
+      finish();
+    } else {
+      auto result = function();
+      finish();
+      return result;
+    }
+  }
+
+  const std::vector<std::pair<std::string, std::vector<double>>>& get() const { return stages; }
+};
+
+double median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  size_t middle = samples.size() / 2;
+  return samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+}
+
+std::string json_string(const std::string& value) {
+  std::string result = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result + "\"";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Stages
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct StageCounts {
+  size_t triples = 0;
+  size_t normalized_triples = 0;
+  size_t triples_maps = 0;
+  size_t sub_graphs = 0;
+  size_t plans = 0;
+  size_t plan_bytes = 0;
+};
+
+size_t count_lines(const std::string& text) {
+  return std::count(text.begin(), text.end(), '\n');
+}
+
+StageCounts run_stages(const std::string& mapping, unsigned int num_threads, StageTimes& times) {
+  using namespace rml_normalizer;
+
+  StageCounts counts;
+  int bn_counter = 58932;
+
+  std::vector<NTriple> triples = times.time("parse", [&]() { return RDFParser().parse(mapping); });
+  times.time("validate", [&]() { validator(triples); });
+
+  std::vector<NTriple> classes = times.time("expand_classes", [&]() { return expand_classes(triples, bn_counter); });
+  std::vector<NTriple> constants =
+      times.time("expand_constants", [&]() { return expand_constants(classes, bn_counter); });
+  std::vector<NTriple> poms =
+      times.time("expand_predicate_object_maps", [&]() { return expand_predicate_object_maps(constants, bn_counter); });
+  std::vector<NTriple> separated =
+      times.time("separate_predicate_object_maps", [&]() { return separate_predicate_object_maps(poms); });
+  std::vector<std::string> triples_maps =
+      times.time("extract_triple_map_nodes", [&]() { return extract_triple_map_nodes(separated); });
+
+  std::vector<std::vector<NTriple>> sub_graphs;
+  times.time("separate_triple_maps", [&]() {
+    separate_triple_maps(triples_maps, separated,
+                         [&](std::vector<NTriple>&& sub_graph) { sub_graphs.push_back(std::move(sub_graph)); });
+  });
+
+  // Every subgraph on its own, as the text interface converts them
+  std::string plans = times.time("converter", [&]() {
+    std::string result;
+    for (const auto& sub_graph : sub_graphs) {
+      result += ra_converter::converter(sub_graph);
+    }
+    return result;
+  });
+
+  // The batch conversion of the compiler, with plan groups and cost ordering
+  ra_converter::sort_sub_graphs(sub_graphs);
+  std::string batch_plans =
+      times.time("convert_sub_graphs", [&]() { return ra_converter::convert_sub_graphs(sub_graphs, num_threads); });
+
+  counts.triples = triples.size();
+  counts.normalized_triples = separated.size();
+  counts.triples_maps = triples_maps.size();
+  counts.sub_graphs = sub_graphs.size();
+  counts.plans = count_lines(batch_plans);
+  counts.plan_bytes = batch_plans.size();
+  return counts;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Main
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void print_usage() {
+  std::cerr << "Usage: stage_benchmark [-r repetitions] [-t threads] [-o key=value]... mapping_file" << std::endl
+            << std::endl
+            << "Runs every frontend stage on the mapping and prints the minimum, median and mean" << std::endl
+            << "time of each stage in milliseconds as JSON. Options are converter options." << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::string mapping_path;
+  int repetitions = 5;
+  unsigned int num_threads = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      repetitions = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      num_threads = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      std::string option = argv[++i];
+      size_t pos = option.find('=');
+      if (pos == std::string::npos ||
+          ra_converter::set_converter_option(option.substr(0, pos).c_str(), option.substr(pos + 1).c_str()) != 0) {
+        std::cerr << "Error: Invalid converter option '" << option << "'." << std::endl;
+        return 2;
+      }
+    } else if (mapping_path.empty() && argv[i][0] != '-') {
+      mapping_path = argv[i];
+    } else {
+      print_usage();
+      return 2;
+    }
+  }
+  if (mapping_path.empty()) {
+    print_usage();
+    return 2;
+  }
+
+  std::ifstream file(mapping_path, std::ios::in | std::ios::binary);
+  if (!file) {
+    std::cerr << "Error: Could not open file: " << mapping_path << std::endl;
+    return 1;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string mapping = buffer.str();
+
+  StageTimes times;
+  StageCounts counts;
+  try {
+    for (int r = 0; r < repetitions; ++r) {
+      counts = run_stages(mapping, num_threads, times);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ostringstream json;
+  json << "{\n  \"mapping\": " << json_string(mapping_path) << ",\n  \"repetitions\": " << repetitions
+       << ",\n  \"threads\": " << num_threads << ",\n  \"counts\": {\"triples\": " << counts.triples
+       << ", \"normalized_triples\": " << counts.normalized_triples << ", \"triples_maps\": " << counts.triples_maps
+       << ", \"sub_graphs\": " << counts.sub_graphs << ", \"plans\": " << counts.plans
+       << ", \"plan_bytes\": " << counts.plan_bytes << "},\n  \"stages\": {";
+
+  const auto& stages = times.get();
+  for (size_t i = 0; i < stages.size(); ++i) {
+    const auto& [stage, samples] = stages[i];
+    double sum = 0;
+    for (double sample : samples) {
+      sum += sample;
+    }
+    json << (i == 0 ? "\n" : ",\n") << "    " << json_string(stage) << ": {\"min_ms\": "
+         << *std::min_element(samples.begin(), samples.end()) << ", \"median_ms\": " << median(samples)
+         << ", \"mean_ms\": " << sum / samples.size() << "}";
+  }
+  json << "\n  }\n}\n";
+
+  std::cout << json.str();
+  return 0;
+}
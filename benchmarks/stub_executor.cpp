@@ -0,0 +1,49 @@
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../ra_executor/plan_parser.h"
+
+// Stand-in for the konverter executor in the end-to-end benchmarks. It receives
+// the plans the same way as the backend, parses and validates them and
+// executes nothing, so the handoff can be measured without the backend.
+
+static std::string g_result_str;
+
+extern "C" {
+// Parses and validates the plans, one per line. Returns their counts as
+// "plans=N operators=N bytes=N", or "Error: ..." for the first invalid plan.
+const char* execute_plans(const char* plans) {
+  std::istringstream stream(plans);
+  std::string plan;
+  size_t line = 0;
+  size_t num_plans = 0;
+  size_t num_operators = 0;
+  size_t num_bytes = 0;
+
+  try {
+    while (std::getline(stream, plan)) {
+      line++;
+      num_bytes += plan.size() + 1;
+      if (plan.empty()) {
+        continue;
+      }
+
+      try {
+        ra_executor::PlanNode node = ra_executor::parse_plan(plan);
+        ra_executor::validate_plan(node);
+        num_operators += ra_executor::count_operators(node);
+        num_plans++;
+      } catch (const std::exception& e) {
+        throw std::runtime_error("Plan " + std::to_string(line) + ": " + e.what());
+      }
+    }
+    g_result_str = "plans=" + std::to_string(num_plans) + " operators=" + std::to_string(num_operators) +
+                   " bytes=" + std::to_string(num_bytes);
+  } catch (const std::exception& e) {
+    g_result_str = "Error: " + std::string(e.what());
+  }
+
+  return g_result_str.c_str();
+}
+}
@@ -0,0 +1,49 @@
+import ctypes
+import os
+import sys
+import time
+
+# Stand-in for backend.konverter in the end-to-end benchmarks. run_converter
+# has the signature of the backend and hands the plans to libstubexecutor.so
+# in the same way, which parses and validates them and executes nothing.
+# install() makes "from backend.konverter import run_converter" load it.
+
+LIB_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "libstubexecutor.so")
+
+# One entry per call: the plan bytes, the counts of the executor and the seconds of the call
+handoffs = []
+
+_lib = None
+
+def load_executor():
+    global _lib
+    if _lib is None:
+        try:
+            _lib = ctypes.CDLL(LIB_PATH)
+        except OSError as e:
+            print(f"Error loading '{LIB_PATH}': {e}, build it with benchmarks/build_benchmarks.sh")
+            sys.exit(1)
+        _lib.execute_plans.argtypes = [ctypes.c_char_p]
+        _lib.execute_plans.restype = ctypes.c_char_p
+    return _lib
+
+def run_converter(ra_str, base_uri, continue_on_error, threading_enabled, materialize_constants, heuristic_ordering):
+    lib = load_executor()
+
+    start_time = time.perf_counter()
+    result = lib.execute_plans(ra_str.encode()).decode()
+    seconds = time.perf_counter() - start_time
+
+    if result.startswith("Error:"):
+        print(result)
+        if continue_on_error != "true":
+            sys.exit(1)
+        return
+
+    handoff = {key: int(value) for key, value in (item.split("=") for item in result.split())}
+    handoff["seconds"] = seconds
+    handoffs.append(handoff)
+
+def install():
+    # Replaces the backend for all later imports of backend.konverter
+    sys.modules["backend.konverter"] = sys.modules[__name__]
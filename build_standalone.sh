@@ -51,7 +51,7 @@ echo "All files required files are present."
 echo ""
 
 echo "Cleaning up old shared object files..."
-rm libnormalizer.so libraconverter.so librdfparser.so
+rm libnormalizer.so libraconverter.so librdfparser.so librmlcompiler.so rml_compile libraexecutor.so ra_execute
 echo ""
 
 
@@ -66,6 +66,20 @@ check_if_exists ./libnormalizer.so
 echo ""
 
 echo "Building relational algebra converter ..."
-g++ -std=c++20 -shared -fPIC -o ./libraconverter.so ./ra_converter/ra_converter_rml_io.cpp -O3
+g++ -std=c++20 -shared -fPIC -o ./libraconverter.so ./ra_converter/ra_converter_rml_io.cpp ./ra_converter/plan_profile.cpp ./ra_executor/plan_parser.cpp ./ra_converter/source_splitter.cpp ./ra_converter/source_statistics.cpp -O3 -pthread
 check_if_exists ./libnormalizer.so
+echo ""
+
+echo "Building rml compiler ..."
+g++ -std=c++20 -shared -fPIC -Irdf_parser/serd_lib -o ./librmlcompiler.so ./rml_compiler/rml_compiler.cpp ./rml_compiler/plan_cache.cpp ./rml_compiler/compile_daemon.cpp ./rml_compiler/mapping_partition.cpp ./rml_compiler/incremental_compiler.cpp ./rml_compiler/watch.cpp ./rdf_parser/rdf_parser.cpp ./rdf_parser/serd_lib/*.c ./rml_normalizer/rml_io_normalizer.cpp ./ra_converter/ra_converter_rml_io.cpp ./ra_converter/plan_profile.cpp ./ra_executor/plan_parser.cpp ./ra_converter/source_splitter.cpp ./ra_converter/source_statistics.cpp -O3 -pthread
+check_if_exists ./librmlcompiler.so
+g++ -std=c++20 -o ./rml_compile ./rml_compiler/rml_compile_main.cpp -L. -lrmlcompiler -Wl,-rpath,'$ORIGIN' -O3
+check_if_exists ./rml_compile
+echo ""
+
+echo "Building reference executor ..."
+g++ -std=c++20 -shared -fPIC -o ./libraexecutor.so ./ra_executor/plan_parser.cpp ./ra_executor/csv_table.cpp ./ra_executor/ra_executor.cpp ./ra_converter/source_statistics.cpp -O3 -pthread
+check_if_exists ./libraexecutor.so
+g++ -std=c++20 -o ./ra_execute ./ra_executor/ra_execute_main.cpp -L. -lraexecutor -Wl,-rpath,'$ORIGIN' -O3
+check_if_exists ./ra_execute
 echo ""
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "plan_profile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "../ra_executor/plan_parser.h"
+#include "source_statistics.h"
+
+// Weight of the latest run in the smoothed measurements
+const double smoothing = 0.5;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Fingerprints
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string create_terms_text(const std::vector<ra_executor::CreateTerm>& terms) {
+  std::string text;
+  for (const auto& term : terms) {
+    text += (text.empty() ? "" : ",") + std::string("create(") + term.term_map + "," + term.term_map_type + "," +
+            term.term_type + "," + term.lang_tag + "," + term.data_type + ") -> " + term.position;
+  }
+  return text;
+}
+
+std::string attributes_text(const std::vector<std::string>& attributes) {
+  std::string text;
+  for (const auto& attribute : attributes) {
+    text += (text.empty() ? "" : ",") + attribute;
+  }
+  return text;
+}
+
+// Returns the text of the plan without the rewrites that depend on the data:
+// the ranges of a split source are scanned as the source, semi-join
+// reductions are left out and the inputs of a join are ordered by their text
+// instead of their estimated size. Annotations are dropped, so the keys or
+// Bloom filter of a reduction and the join strategies do not matter either.
+std::string logical_plan_text(const ra_executor::PlanNode& node) {
+  using ra_executor::PlanOperator;
+  switch (node.op) {
+    case PlanOperator::Source:
+    case PlanOperator::Range:
+      return node.source;
+    case PlanOperator::Projection:
+      return "pi[" + attributes_text(node.attributes) + "](" + logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::Selection:
+      return "sigma[not null(" + attributes_text(node.attributes) + ")](" + logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::Distinct:
+      return "delta(" + logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::Limit:
+      return "limit[" + std::to_string(node.limit) + "](" + logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::SemiJoin:
+      return logical_plan_text(node.children[0]);
+    case PlanOperator::Fetch:
+      return "fetch[" + node.source + ":" + attributes_text(node.attributes) + "](" +
+             logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::Union: {
+      std::string left = logical_plan_text(node.children[0]);
+      std::string right = logical_plan_text(node.children[1]);
+      // The ranges of one source
+      if (left == right) {
+        return left;
+      }
+      return "(" + left + ") cup (" + right + ")";
+    }
+    case PlanOperator::Join: {
+      std::string left = logical_plan_text(node.children[0]);
+      std::string right = logical_plan_text(node.children[1]);
+      std::vector<std::array<std::string, 2>> conditions = node.conditions;
+      if (right < left) {
+        std::swap(left, right);
+        for (auto& condition : conditions) {
+          std::swap(condition[0], condition[1]);
+        }
+      }
+      std::string condition_text;
+      for (const auto& condition : conditions) {
+        condition_text += (condition_text.empty() ? "" : ",") + condition[0] + "=" + condition[1];
+      }
+      return "(" + left + ") bowtie " + (conditions.empty() ? "" : "[" + condition_text + "] ") + "(" + right + ")";
+    }
+    case PlanOperator::Create:
+      return "pi[" + create_terms_text(node.heads[0]) + "](" + logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::Bind:
+      return "bind[" + create_terms_text(node.heads[0]) + "](" + logical_plan_text(node.children[0]) + ")";
+    case PlanOperator::Constant:
+      return "const[" + create_terms_text(node.heads[0]) + "]";
+    case PlanOperator::Fork: {
+      std::string heads;
+      for (size_t i = 0; i < node.heads.size(); ++i) {
+        heads += i > 0 ? ";" : "";
+        if (!node.head_filters[i].empty()) {
+          heads += "sigma[not null(" + attributes_text(node.head_filters[i]) + ")] ";
+        }
+        heads += create_terms_text(node.heads[i]);
+      }
+      return "fork[" + heads + "](" + logical_plan_text(node.children[0]) + ")";
+    }
+  }
+  return "";
+}
+
+std::string plan_fingerprint(const std::string& plan) {
+  std::ostringstream fingerprint;
+  try {
+    fingerprint << std::hex << hash_value(logical_plan_text(ra_executor::parse_plan(plan)));
+    return fingerprint.str();
+  } catch (const std::exception&) {
+    // Not a plan of the converter, only its annotations are dropped
+  }
+
+  // Drop all "@[...]" annotation blocks, they do not contain brackets
+  std::string stripped;
+  stripped.reserve(plan.size());
+  for (size_t pos = 0; pos < plan.size(); ++pos) {
+    if (plan[pos] == '@' && pos + 1 < plan.size() && plan[pos + 1] == '[') {
+      size_t end = plan.find(']', pos);
+      if (end != std::string::npos) {
+        pos = end;
+        continue;
+      }
+    }
+    stripped += plan[pos];
+  }
+
+  fingerprint << std::hex << hash_value(stripped);
+  return fingerprint.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Plan profile
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PlanProfile::set_profile_path(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (path != profile_path) {
+    profile_path = path;
+    entries.clear();
+    loaded = false;
+    modified = false;
+  }
+}
+
+// Format:
+//   fingerprint <tab> seconds <tab> triples <tab> runs
+void PlanProfile::load() {
+  loaded = true;
+  entries.clear();
+  loaded_mtime = 0;
+  if (profile_path.empty()) {
+    return;
+  }
+  get_file_mtime(profile_path, loaded_mtime);
+
+  std::ifstream file(profile_path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::vector<std::string> parts;
+    std::istringstream stream(line);
+    std::string part;
+    while (std::getline(stream, part, '\t')) {
+      parts.push_back(part);
+    }
+    if (parts.size() != 4) {
+      continue;
+    }
+
+    try {
+      PlanTimings timings;
+      timings.fingerprint = parts[0];
+      timings.seconds = std::stod(parts[1]);
+      timings.triples = std::stod(parts[2]);
+      timings.runs = std::stoull(parts[3]);
+      entries[timings.fingerprint] = timings;
+    } catch (const std::exception&) {
+      // Ignore broken entries, they are measured again
+    }
+  }
+}
+
+void PlanProfile::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (profile_path.empty() || !modified) {
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::path path(profile_path);
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), ec);
+  }
+
+  std::string tmp_path = profile_path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      return;
+    }
+    for (const auto& [fingerprint, timings] : entries) {
+      file << timings.fingerprint << "\t" << timings.seconds << "\t" << timings.triples << "\t" << timings.runs
+           << "\n";
+    }
+  }
+  std::filesystem::rename(tmp_path, profile_path, ec);
+  get_file_mtime(profile_path, loaded_mtime);
+  modified = false;
+}
+
+void PlanProfile::refresh() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!loaded || profile_path.empty() || modified) {
+    return;
+  }
+
+  int64_t mtime = 0;
+  get_file_mtime(profile_path, mtime);
+  if (mtime != loaded_mtime) {
+    load();
+  }
+}
+
+bool PlanProfile::get(const std::string& fingerprint, PlanTimings& result) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (profile_path.empty()) {
+    return false;
+  }
+  if (!loaded) {
+    load();
+  }
+
+  auto it = entries.find(fingerprint);
+  if (it == entries.end()) {
+    return false;
+  }
+  result = it->second;
+  return true;
+}
+
+void PlanProfile::record(const std::string& fingerprint, double seconds, double triples) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (profile_path.empty()) {
+    return;
+  }
+  if (!loaded) {
+    load();
+  }
+
+  PlanTimings& timings = entries[fingerprint];
+  if (timings.runs == 0) {
+    timings.fingerprint = fingerprint;
+    timings.seconds = seconds;
+    timings.triples = triples;
+  } else {
+    timings.seconds = smoothing * seconds + (1 - smoothing) * timings.seconds;
+    timings.triples = smoothing * triples + (1 - smoothing) * timings.triples;
+  }
+  timings.runs++;
+  modified = true;
+}
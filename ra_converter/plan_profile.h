@@ -0,0 +1,50 @@
+#ifndef PLAN_PROFILE_H
+#define PLAN_PROFILE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct PlanTimings {
+  std::string fingerprint;
+  double seconds = 0;  // smoothed execution time
+  double triples = 0;  // smoothed number of output triples
+  uint64_t runs = 0;
+};
+
+// Execution times and output sizes of plans measured in previous runs.
+// Plans are keyed by the hash of their text before the rewrites that depend
+// on the data, see plan_fingerprint(), so a measurement still matches the
+// plan after the sources grew or shrank. Measurements of several runs are
+// smoothed exponentially. The profile is persisted in a tab separated text file,
+// and reloaded when another process saved it, e.g. for the compile daemon.
+class PlanProfile {
+ private:
+  std::string profile_path;
+  std::unordered_map<std::string, PlanTimings> entries;
+  std::mutex mutex;
+  bool loaded = false;
+  bool modified = false;
+  int64_t loaded_mtime = 0;  // modification time of the file when it was loaded
+
+  void load();
+
+ public:
+  void set_profile_path(const std::string& path);
+
+  // Reloads the profile if another process saved it since it was loaded
+  void refresh();
+
+  // Returns false if the plan was not measured before
+  bool get(const std::string& fingerprint, PlanTimings& result);
+  void record(const std::string& fingerprint, double seconds, double triples);
+  void save();
+};
+
+// Returns the fingerprint of a plan, i.e. the hash of its text without
+// annotations, range splits and semi-join reductions, and with the inputs of
+// every join in a fixed order
+std::string plan_fingerprint(const std::string& plan);
+
+#endif
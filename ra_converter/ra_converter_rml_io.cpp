@@ -1,16 +1,34 @@
+#include "ra_converter_rml_io.h"
+
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
 #include <format>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <numeric>
 #include <random>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "plan_profile.h"
+#include "source_splitter.h"
+#include "source_statistics.h"
+
+namespace ra_converter {
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////// Struct Definitions
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -18,12 +36,6 @@
 // used to store string result
 static std::string g_result_str;
 
-struct NTriple {
-  std::string subject;
-  std::string predicate;
-  std::string object;
-};
-
 struct Subject {
   std::string term_map_type;  // template, constant, reference
   std::string term_type;      // iri, blanknode, literal
@@ -43,7 +55,7 @@ struct Object {
   std::string lang_tag = "None";
   std::string data_type = "None";
   std::string join_type = "None";
-  std::array<std::string, 2> join_condition = {"", ""};
+  std::vector<std::array<std::string, 2>> join_conditions;  // child and parent attribute pairs
 };
 
 struct Graph {
@@ -52,6 +64,16 @@ struct Graph {
   std::string term_map;       // contains value
 };
 
+// Predicate object map with a referencing object map
+struct JoinMapping {
+  std::string child_source;
+  std::string parent_source;
+  Subject subj;
+  Predicate pred;
+  Object obj;
+  std::vector<Graph> graphs;
+};
+
 std::unordered_set<std::string> valid_language_subtags = {
     "en",  // English
     "es",  // Spanish
@@ -77,6 +99,91 @@ std::unordered_set<std::string> valid_language_subtags = {
 
 // Global unordered_set to track generated strings
 std::unordered_set<std::string> generated_strings;
+
+// Options controlling the shape of the generated plans
+struct ConverterOptions {
+  bool extended_grammar = false;       // emit operators and annotations beyond the konverter grammar
+  bool materialize_constants = true;   // fold and hoist constant term maps into bind[] nodes
+  bool push_null_filters = true;      // filter null values right after the source projections
+  bool early_distinct = true;         // deduplicate the parent projection before joins
+  std::map<std::string, std::set<std::string>> unique_keys;  // source -> declared key attributes
+  bool statistics = true;             // annotate plans with cardinalities from sampled sources
+  bool join_hints = true;             // annotate joins with a physical join strategy
+  double broadcast_threshold = 64 << 20;  // maximum bytes of a broadcast join input
+  uint64_t split_size = 128 << 20;        // target bytes of a range scan, 0 disables splitting
+  bool group_identical_maps = true;       // share one plan between mappings differing only in their source
+  bool validate_references = true;        // check referenced attributes against the source header
+  bool share_joins = true;                // evaluate mappings on the same join with a single join
+  bool late_materialization = false;      // join parents on keys and row IDs, fetch the other attributes after
+  bool semi_join_reduction = true;        // filter parents on the child keys before the join
+  double semi_join_threshold = 0.5;       // maximum estimated fraction of parent rows kept by a reduction
+  bool cost_ordering = true;              // order plans by estimated cost, largest first
+};
+
+// Returns the options the conversion uses. The konverter backend has only
+// been shown to accept source projections, equi-joins and create projections,
+// so without extended_grammar the rewrites that emit any other operator are
+// off, whatever they were set to. Rewrites that only choose among plans of
+// that grammar, e.g. the join sides and the plan order, are kept.
+ConverterOptions effective_options(const ConverterOptions &options) {
+  ConverterOptions result = options;
+  if (!options.extended_grammar) {
+    result.materialize_constants = false;  // bind[] and limit[]
+    result.push_null_filters = false;      // sigma[]
+    result.early_distinct = false;         // delta()
+    result.split_size = 0;                 // range[] and cup
+    result.group_identical_maps = false;   // cup
+    result.share_joins = false;            // fork[]
+    result.late_materialization = false;   // fetch[]
+    result.semi_join_reduction = false;    // ltimes
+  }
+  return result;
+}
+
+// Options as set, and the options the conversion uses
+static ConverterOptions g_requested_options;
+static ConverterOptions g_options = effective_options(g_requested_options);
+
+// Sampled source statistics, shared by all conversions
+static StatisticsCatalog g_statistics;
+
+// Record aligned split points of large sources, shared by all conversions
+static SplitPointCache g_split_points;
+
+// Measured execution times of plans from previous runs
+static PlanProfile g_plan_profile;
+
+// An input of a join, i.e. a (filtered) projection of a source
+struct JoinRelation {
+  std::string source;
+  std::string node;
+  double estimated_size;
+  bool has_statistics = false;
+  double size_bytes = 0;                            // size of the source on disk
+  std::map<std::string, std::string> sort_orders;  // attribute -> order of the rows
+};
+
+// Equality between an attribute of two join relations
+struct JoinPredicate {
+  size_t left_relation;
+  std::string left_attribute;
+  size_t right_relation;
+  std::string right_attribute;
+};
+
+// Filter of a relation on the keys of another relation, applied before a join
+struct SemiJoinReduction {
+  std::string condition;   // e.g. "parent.csv_ID=child.csv_Sport"
+  std::string key_node;    // plan of the keys, empty if there is no reduction
+  std::string filter;      // keys (exact set) or bloom (Bloom filter)
+  double selectivity = 1;  // estimated fraction of the rows that is kept
+};
+
+// A single create() term of a projection, e.g. "create(...) -> S"
+struct CreateTerm {
+  std::string expression;
+  bool constant;
+};
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -227,6 +334,23 @@ std::string get_root_tm(const std::vector<NTriple> &triples) {
   return tms[i];
 }
 
+std::string get_source(const std::vector<NTriple> &triples,
+                       const std::string &tm) {
+  std::vector<std::string> logical_sources = find_matching_objects(
+      triples, tm, "http://semweb.mmlab.be/ns/rml#logicalSource");
+  if (logical_sources.empty()) {
+    throw std::runtime_error("No logicalSource found for " + tm + ".");
+  }
+
+  std::vector<std::string> sources = find_matching_objects(
+      triples, logical_sources[0], "http://semweb.mmlab.be/ns/rml#source");
+  if (sources.empty()) {
+    throw std::runtime_error("No source found for " + tm + ".");
+  }
+
+  return sources[0];
+}
+
 std::string get_predicate_object_map(const std::vector<NTriple> &triples,
                                      const std::string &root_tm) {
   std::vector<std::string> res = find_matching_objects(
@@ -376,8 +500,7 @@ Subject get_subject(const std::vector<NTriple> &triples,
     if (new_term_type == "http://www.w3.org/ns/r2rml#BlankNode") {
       result.term_type = "blanknode";
     } else if (new_term_type == "http://www.w3.org/ns/r2rml#Literal") {
-      std::cout << "Literal not supported!" << std::endl;
-      std::exit(1);
+      throw std::runtime_error("Literal not supported as subject term type!");
     }
   }
 
@@ -477,9 +600,7 @@ Object get_object_wo_join(const std::vector<NTriple> &triples,
         triples, lang_map_nodes[0], "http://www.w3.org/ns/r2rml#constant")[0];
     // Check if lang tag is valid
     if (valid_language_subtags.find(lang_tag) == valid_language_subtags.end()) {
-      std::cout << "Runtime error occurred. Language tag is not supported!"
-                << std::endl;
-      std::exit(1);
+      throw std::runtime_error("Language tag '" + lang_tag + "' is not supported!");
     }
     result.lang_tag = lang_tag;
   }
@@ -568,11 +689,10 @@ std::tuple<Object, std::string> get_object_w_join(
   // If no joinCondition is specified -> "naturalJoin" else "innerJoin"
   result.join_type = "natural-join";
 
+  // Several join conditions form a composite key
   std::vector<std::string> join_condition_nodes = find_matching_objects(
       triples, object_node, "http://www.w3.org/ns/r2rml#joinCondition");
-  std::string join_condition_node = "";
-  if (join_condition_nodes.size() == 1) {
-    join_condition_node = join_condition_nodes[0];
+  for (const auto &join_condition_node : join_condition_nodes) {
     result.join_type = "equi-join";
 
     // Get Join conditions
@@ -584,9 +704,12 @@ std::tuple<Object, std::string> get_object_w_join(
         triples, join_condition_node, "http://www.w3.org/ns/r2rml#parent");
     std::string parent = parent_arr[0];
 
-    result.join_condition[0] = child;
-    result.join_condition[1] = parent;
+    result.join_conditions.push_back({child, parent});
   }
+  // The order of the conditions does not depend on the order of the triples
+  std::sort(result.join_conditions.begin(), result.join_conditions.end());
+  result.join_conditions.erase(std::unique(result.join_conditions.begin(), result.join_conditions.end()),
+                               result.join_conditions.end());
 
   // Get parentTM
   std::vector<std::string> parent_tm_nodes = find_matching_objects(
@@ -647,7 +770,8 @@ std::tuple<Object, std::string> get_object_w_join(
 
 std::vector<std::string> get_projected_attributes(const Subject &subj,
                                                   const Predicate &pred,
-                                                  const Object &obj) {
+                                                  const Object &obj,
+                                                  const std::vector<Graph> &graphs = {}) {
   std::set<std::string> unique_attributes;
 
   // Handle Subject
@@ -680,18 +804,24 @@ std::vector<std::string> get_projected_attributes(const Subject &subj,
     }
   }
 
-  // Handle join condition if available
-  bool is_empty =
-      std::all_of(obj.join_condition.begin(), obj.join_condition.end(),
-                  [](const std::string &s) { return s.empty(); });
+  // Handle Graph
+  for (const auto &graph : graphs) {
+    if (graph.term_map_type == "template") {
+      std::vector<std::string> res = extract_substrings(graph.term_map);
+      unique_attributes.insert(res.begin(), res.end());
+    } else if (graph.term_map_type == "reference" && !graph.term_map.empty()) {
+      unique_attributes.insert(graph.term_map);
+    }
+  }
+
+  // Handle join conditions if available
   // if object is empty -> generation of child join; else geneartion of parent
   // join
-
-  if (!is_empty) {
+  for (const auto &join_condition : obj.join_conditions) {
     if (obj.term_map_type.empty()) {
-      unique_attributes.insert(obj.join_condition[0]);
+      unique_attributes.insert(join_condition[0]);
     } else {
-      unique_attributes.insert(obj.join_condition[1]);
+      unique_attributes.insert(join_condition[1]);
     }
   }
 
@@ -714,73 +844,879 @@ std::string replace_substring(const std::string &original,
   return result;
 }
 
-std::string create_complex_tree(const std::vector<NTriple> &triples) {
-  // Get source
-  std::vector<std::string> sources = find_matching_objects(triples, "", "http://semweb.mmlab.be/ns/rml#source");
+// Wraps a source projection into a selection that drops rows with a null or
+// empty value in any of the projected attributes. RML generates no triple for
+// such rows, so they can be removed before any join or create.
+std::string create_null_filter_node(const std::string &arguments,
+                                    const std::string &projection_node) {
+  if (!g_options.push_null_filters || arguments.empty()) {
+    return projection_node;
+  }
+
+  return "sigma[not null(" + arguments + ")](" + projection_node + ")";
+}
+
+// Deduplicates the parent side of a join. The output is a set of triples,
+// so removing duplicate parent rows never changes the result.
+std::string create_distinct_node(const std::string &input_node) {
+  if (!g_options.early_distinct) {
+    return input_node;
+  }
+
+  return "delta(" + input_node + ")";
+}
+
+// Attaches an annotation to the root of a plan node, e.g. "node@[key=value]".
+// Annotations of the same node are merged into one block. Without the
+// extended grammar, plans are not annotated.
+std::string annotate_node(const std::string &node, const std::string &key,
+                          const std::string &value) {
+  if (!g_options.extended_grammar) {
+    return node;
+  }
+
+  size_t pos = node.rfind("@[");
+  if (pos != std::string::npos && node.back() == ']' &&
+      node.find(')', pos) == std::string::npos) {
+    return node.substr(0, node.size() - 1) + "," + key + "=" + value + "]";
+  }
+
+  return node + "@[" + key + "=" + value + "]";
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Uniqueness inference
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns true if different attribute values always generate different terms.
+// Templates with several attributes may collide, e.g. {a}{b} for "1","23"
+// and "12","3".
+bool is_injective(const std::string &term_map_type, const std::string &term_map) {
+  if (term_map_type == "reference") {
+    return true;
+  }
+  if (term_map_type == "template") {
+    return extract_substrings(term_map).size() == 1;
+  }
+  return false;
+}
+
+// Returns true if the term is injective over a declared key of the source,
+// i.e. every source row generates a different term.
+bool is_key_term(const std::string &term_map_type, const std::string &term_map,
+                 const std::string &source) {
+  auto it = g_options.unique_keys.find(source);
+  if (it == g_options.unique_keys.end() || !is_injective(term_map_type, term_map)) {
+    return false;
+  }
+
+  std::vector<std::string> attributes = {term_map};
+  if (term_map_type == "template") {
+    attributes = extract_substrings(term_map);
+  }
+
+  return it->second.count(attributes[0]) > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string join_create_terms(const std::vector<CreateTerm> &terms, bool constant) {
+  std::string result = "";
+  for (const auto &term : terms) {
+    if (term.constant != constant) {
+      continue;
+    }
+    if (!result.empty()) {
+      result += ",";
+    }
+    result += term.expression;
+  }
+  return result;
+}
+
+// Generates the create projection on top of input_node.
+// With constant folding enabled, constant terms are hoisted into a bind[]
+// node evaluated once instead of per row. If every term is constant, the
+// triple is only generated for a logical source with at least one row, so
+// the bind[] reads the first row of the input and no more.
+std::string create_projection_node(const std::vector<CreateTerm> &terms,
+                                   const std::string &input_node) {
+  bool any_constant = false;
+  bool all_constant = true;
+  for (const auto &term : terms) {
+    any_constant = any_constant || term.constant;
+    all_constant = all_constant && term.constant;
+  }
+
+  if (!g_options.materialize_constants || !any_constant) {
+    std::string all_terms = "";
+    for (size_t i = 0; i < terms.size(); ++i) {
+      all_terms += terms[i].expression;
+      if (i < terms.size() - 1) {
+        all_terms += ",";
+      }
+    }
+    return "pi[" + all_terms + "](" + input_node + ")";
+  }
+
+  if (all_constant) {
+    // Nothing left to compute per row, one input row is enough
+    return "bind[" + join_create_terms(terms, true) + "](limit[1](" + input_node + "))";
+  }
+
+  return "bind[" + join_create_terms(terms, true) + "](pi[" + join_create_terms(terms, false) + "](" + input_node + "))";
+}
+
+// Creates one plan per graph, or a single plan if only the default graph is used
+std::vector<std::string> create_projection_nodes(const std::vector<CreateTerm> &terms,
+                                                 const std::vector<Graph> &graphs,
+                                                 const std::string &input_node) {
+  std::vector<std::string> proj_nodes;
+  for (const auto &graph : graphs) {
+    if (graph.term_map.empty()) {
+      continue;
+    }
+    std::vector<CreateTerm> graph_terms = terms;
+    graph_terms.push_back({"create(" + graph.term_map + "," + graph.term_map_type + "," + graph.term_type + ") -> G",
+                           graph.term_map_type == "constant"});
+    proj_nodes.push_back(create_projection_node(graph_terms, input_node));
+  }
+
+  if (proj_nodes.empty()) {
+    proj_nodes.push_back(create_projection_node(terms, input_node));
+  }
+
+  return proj_nodes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Source schema
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the sampled statistics of a source, false if they are not available
+bool get_source_statistics(const std::string &source, SourceStatistics &stats) {
+  if (!g_options.statistics) {
+    return false;
+  }
+  return g_statistics.get(source, stats);
+}
+
+// Virtual attribute holding the byte offset of a record in its source. The
+// offset stays valid under range scans and lets a fetch[] read the record
+// directly.
+const std::string row_id_attribute = "#rowid";
+
+// Checks that every referenced attribute is a column of the source, so a
+// wrong reference fails the conversion instead of the run. Only CSV sources
+// with a header are checked.
+void validate_references(const std::string &source, const std::vector<std::string> &attributes) {
+  SourceStatistics stats;
+  if (!g_options.validate_references || !g_statistics.get(source, stats) || stats.columns.empty()) {
+    return;
+  }
+
+  std::string missing = "";
+  for (const auto &attribute : attributes) {
+    if (attribute != row_id_attribute && !stats.columns.contains(attribute)) {
+      missing += (missing.empty() ? "'" : ", '") + attribute + "'";
+    }
+  }
+  if (!missing.empty()) {
+    throw std::runtime_error("Source '" + source + "' has no column " + missing + ".");
+  }
+}
+
+// Annotates the projection of the sources with the facts that hold for an
+// attribute in every source:
+//   numeric:  all values are numbers
+//   iri_safe: no value needs percent-encoding in an IRI template
+//   not_null: no value is null
+// Facts are only derived from completely read sources, a sample can miss
+// the row that breaks them.
+std::string annotate_column_facts(const std::string &node, const std::vector<std::string> &sources,
+                                  const std::vector<std::string> &attributes) {
+  std::vector<SourceStatistics> source_stats(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (!get_source_statistics(sources[i], source_stats[i]) || !source_stats[i].complete) {
+      return node;
+    }
+  }
+
+  std::string numeric = "";
+  std::string iri_safe = "";
+  std::string not_null = "";
+  for (const auto &attribute : attributes) {
+    if (attribute == row_id_attribute) {
+      continue;
+    }
+    bool is_numeric = true;
+    bool is_iri_safe = true;
+    bool is_not_null = true;
+    for (const auto &stats : source_stats) {
+      auto it = stats.columns.find(attribute);
+      if (it == stats.columns.end()) {
+        return node;
+      }
+      is_numeric = is_numeric && it->second.numeric;
+      is_iri_safe = is_iri_safe && it->second.iri_safe;
+      is_not_null = is_not_null && it->second.null_ratio == 0;
+    }
+    if (is_numeric) {
+      numeric += (numeric.empty() ? "" : "+") + attribute;
+    }
+    if (is_iri_safe) {
+      iri_safe += (iri_safe.empty() ? "" : "+") + attribute;
+    }
+    if (is_not_null) {
+      not_null += (not_null.empty() ? "" : "+") + attribute;
+    }
+  }
+
+  std::string result = node;
+  if (!numeric.empty()) {
+    result = annotate_node(result, "numeric", numeric);
+  }
+  if (!iri_safe.empty()) {
+    result = annotate_node(result, "iri_safe", iri_safe);
+  }
+  if (!not_null.empty()) {
+    result = annotate_node(result, "not_null", not_null);
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Join planning
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Assumed average row width of sources without statistics
+const double default_row_bytes = 100;
+
+// Fallback row count for sources that can not be found on disk
+const double default_source_rows = 10000;
+
+// Estimates the number of rows of a source, from its size on disk if it was not sampled
+double estimate_source_rows(const std::string &source) {
+  SourceStatistics stats;
+  if (get_source_statistics(source, stats)) {
+    return std::max(1.0, stats.row_count);
+  }
+
+  std::error_code ec;
+  std::uintmax_t size = std::filesystem::file_size(source, ec);
+  if (ec) {
+    return default_source_rows;
+  }
+  return std::max(1.0, size / default_row_bytes);
+}
+
+// Estimates the rows of a source left after filtering nulls in the attributes
+double estimate_non_null_rows(const SourceStatistics &stats,
+                              const std::vector<std::string> &attributes) {
+  double rows = stats.row_count;
+  for (const auto &attribute : attributes) {
+    auto it = stats.columns.find(attribute);
+    if (it != stats.columns.end()) {
+      rows *= 1.0 - it->second.null_ratio;
+    }
+  }
+  return std::max(1.0, rows);
+}
+
+// Estimates the distinct rows of a projection on the attributes
+double estimate_distinct_rows(const SourceStatistics &stats,
+                              const std::vector<std::string> &attributes,
+                              double rows) {
+  double distinct = 1;
+  for (const auto &attribute : attributes) {
+    auto it = stats.columns.find(attribute);
+    if (it == stats.columns.end()) {
+      return rows;
+    }
+    distinct *= std::max(1.0, it->second.distinct_count);
+  }
+  return std::min(rows, distinct);
+}
+
+// Estimates the distinct values of an attribute of a join relation
+double estimate_distinct_values(const JoinRelation &relation, const std::string &attribute) {
+  SourceStatistics stats;
+  if (relation.has_statistics && get_source_statistics(relation.source, stats)) {
+    auto it = stats.columns.find(attribute);
+    if (it != stats.columns.end()) {
+      return std::clamp(it->second.distinct_count, 1.0, relation.estimated_size);
+    }
+  }
+  return relation.estimated_size;
+}
+
+// Annotates a node with its estimated cardinality
+std::string annotate_rows(const std::string &node, double rows) {
+  return annotate_node(node, "rows", std::to_string(std::llround(rows)));
+}
+
+// Input or result of a join
+struct JoinPlan {
+  std::string node;
+  double cardinality = 0;
+  double bytes = 0;
+  int relation = -1;  // index of the relation for leaves
+};
+
+// Returns the join attributes of one side as "source_attribute", joined by "+"
+std::string join_key(const std::vector<JoinPredicate> &predicates,
+                     const std::vector<JoinRelation> &relations, bool left) {
+  std::string key = "";
+  for (const auto &predicate : predicates) {
+    if (!key.empty()) {
+      key += "+";
+    }
+    if (left) {
+      key += relations[predicate.left_relation].source + "_" + predicate.left_attribute;
+    } else {
+      key += relations[predicate.right_relation].source + "_" + predicate.right_attribute;
+    }
+  }
+  return key;
+}
+
+// Annotates a join with a physical strategy:
+//   merge:            both inputs are sources sorted on the join key in the same order
+//   broadcast:        the build side is small enough to be sent to every worker
+//   partitioned_hash: both sides are hash partitioned on the join key
+// The partition keys are named for every strategy, so the backend does not
+// need to derive them. A broadcast join does not partition its inputs, but
+// the keys still name the join attributes of both sides.
+std::string annotate_join_strategy(const std::string &join_operator,
+                                   const JoinPlan &probe, const JoinPlan &build,
+                                   const std::vector<JoinPredicate> &predicates,
+                                   const std::vector<JoinRelation> &relations) {
+  bool sorted = probe.relation >= 0 && build.relation >= 0;
+  for (const auto &predicate : predicates) {
+    if (!sorted) {
+      break;
+    }
+    const auto &left_orders = relations[predicate.left_relation].sort_orders;
+    const auto &right_orders = relations[predicate.right_relation].sort_orders;
+    auto left = left_orders.find(predicate.left_attribute);
+    auto right = right_orders.find(predicate.right_attribute);
+    sorted = left != left_orders.end() && right != right_orders.end() && left->second == right->second;
+  }
+
+  std::string result = join_operator;
+  if (sorted) {
+    result = annotate_node(result, "strategy", "merge");
+  } else if (build.bytes <= g_options.broadcast_threshold) {
+    result = annotate_node(result, "strategy", "broadcast");
+  } else {
+    result = annotate_node(result, "strategy", "partitioned_hash");
+  }
+
+  result = annotate_node(result, "partition_key_left", join_key(predicates, relations, true));
+  result = annotate_node(result, "partition_key_right", join_key(predicates, relations, false));
+  return result;
+}
+
+// Estimates the distinct keys of one side of a join. The distinct values of
+// a composite key are bounded by the product of the distinct values of its
+// attributes and by the rows of their relation.
+double estimate_distinct_keys(const std::vector<JoinPredicate> &predicates,
+                              const std::vector<JoinRelation> &relations, bool left) {
+  std::map<size_t, double> relation_keys;
+  for (const auto &predicate : predicates) {
+    size_t relation = left ? predicate.left_relation : predicate.right_relation;
+    const std::string &attribute = left ? predicate.left_attribute : predicate.right_attribute;
+    auto it = relation_keys.emplace(relation, 1.0).first;
+    it->second = std::min(it->second * estimate_distinct_values(relations[relation], attribute),
+                          std::max(1.0, relations[relation].estimated_size));
+  }
+
+  double keys = 1;
+  for (const auto &[relation, relation_key] : relation_keys) {
+    keys *= relation_key;
+  }
+  return keys;
+}
+
+// Joins two partial plans, the smaller input is placed on the right (build) side
+JoinPlan join_plans(const JoinPlan &left, const JoinPlan &right,
+                    std::vector<JoinPredicate> predicates,
+                    const std::vector<JoinRelation> &relations,
+                    bool annotate) {
+  const JoinPlan *probe = &left;
+  const JoinPlan *build = &right;
+  if (left.cardinality < right.cardinality) {
+    std::swap(probe, build);
+    for (auto &predicate : predicates) {
+      predicate = {predicate.right_relation, predicate.right_attribute,
+                   predicate.left_relation, predicate.left_attribute};
+    }
+  }
+
+  // Assume containment of the join values: a key of the side with fewer
+  // distinct keys finds its matches on the other side
+  double key_size = std::max(estimate_distinct_keys(predicates, relations, true),
+                             estimate_distinct_keys(predicates, relations, false));
+
+  JoinPlan result;
+  result.cardinality = std::max(1.0, probe->cardinality * build->cardinality / key_size);
+
+  std::string condition = "";
+  for (size_t i = 0; i < predicates.size(); ++i) {
+    const JoinPredicate &predicate = predicates[i];
+    condition += relations[predicate.left_relation].source + "_" + predicate.left_attribute + "=" +
+                 relations[predicate.right_relation].source + "_" + predicate.right_attribute;
+    if (i < predicates.size() - 1) {
+      condition += ",";
+    }
+  }
+
+  // Assume the joined rows are as wide as both inputs together
+  result.bytes = result.cardinality * (probe->bytes / std::max(1.0, probe->cardinality) +
+                                       build->bytes / std::max(1.0, build->cardinality));
+
+  std::string join_operator = "bowtie [" + condition + "]";
+  if (annotate) {
+    join_operator = annotate_rows(join_operator, result.cardinality);
+  }
+  if (g_options.join_hints) {
+    join_operator = annotate_join_strategy(join_operator, *probe, *build, predicates, relations);
+  }
+
+  result.node = "(" + probe->node + ") " + join_operator + " (" + build->node + ")";
+  return result;
+}
+
+// Joins two relations on the predicates. The normalizer emits at most one
+// referencing object map per subgraph, so every join has two inputs and only
+// their sides are chosen, see join_plans(). The join is annotated with its
+// cardinality if both relations were sampled.
+JoinPlan create_join_plan(const std::vector<JoinRelation> &relations,
+                          const std::vector<JoinPredicate> &predicates) {
+  if (relations.size() != 2) {
+    throw std::runtime_error("Only joins of two relations are supported.");
+  }
+
+  bool annotate = relations[0].has_statistics && relations[1].has_statistics;
+
+  std::vector<JoinPlan> leaves;
+  for (size_t i = 0; i < relations.size(); ++i) {
+    JoinPlan leaf;
+    leaf.node = relations[i].node;
+    leaf.cardinality = relations[i].estimated_size;
+    leaf.bytes = relations[i].size_bytes;
+    leaf.relation = i;
+    leaves.push_back(leaf);
+  }
+  return join_plans(leaves[0], leaves[1], predicates, relations, annotate);
+}
+
+// Creates the scan of a source. Sources larger than the split size are
+// scanned as a union of record aligned byte ranges, which can be read in
+// parallel. The header is always read from the start of the file.
+std::string create_source_scan_node(const std::string &source) {
+  SplitPoints split_points;
+  if (g_options.split_size == 0 || !g_split_points.get(source, g_options.split_size, split_points) ||
+      split_points.offsets.size() <= 2) {
+    return source;
+  }
+
+  std::string scan_node = "";
+  for (size_t i = 0; i + 1 < split_points.offsets.size(); ++i) {
+    std::string range_node = "range[" + std::to_string(split_points.offsets[i]) + "," +
+                             std::to_string(split_points.offsets[i + 1]) + "](" + source + ")";
+    scan_node += (i > 0 ? " cup (" : "(") + range_node + ")";
+  }
+  return scan_node;
+}
+
+// Creates the projection of the sources on the attributes, followed by the
+// null filter, the semi-join reduction if given and, if distinct is set, a
+// duplicate elimination. Several
+// sources with the same schema are scanned as their union. Each node is
+// annotated with its estimated cardinality if all sources were sampled.
+// Attributes in unfiltered are left to a null filter above the join.
+JoinRelation create_source_relation(const std::vector<std::string> &sources,
+                                    const std::vector<std::string> &attributes,
+                                    bool distinct,
+                                    const SemiJoinReduction &reduction = {},
+                                    const std::set<std::string> &unfiltered = {}) {
+  // Generate argument string, the row ID is never null
+  std::string arguments = "";
+  std::string filter_arguments = "";
+  std::vector<std::string> filter_attributes;
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    arguments += std::format("{}", attributes[i]);
+    if (i < attributes.size() - 1) {
+      arguments += ",";
+    }
+    if (attributes[i] != row_id_attribute && !unfiltered.contains(attributes[i])) {
+      filter_arguments += (filter_arguments.empty() ? "" : ",") + attributes[i];
+      filter_attributes.push_back(attributes[i]);
+    }
+  }
+
+  JoinRelation relation;
+  relation.source = sources[0];
+  relation.has_statistics = true;
+  relation.estimated_size = 0;
+
+  double non_null_rows = 0;
+  double distinct_rows = 0;
+  std::string scan_node = "";
+  for (const auto &source : sources) {
+    validate_references(source, attributes);
+
+    SourceStatistics stats;
+    bool has_statistics = get_source_statistics(source, stats);
+    relation.has_statistics = relation.has_statistics && has_statistics;
+
+    double rows = estimate_source_rows(source);
+    double source_non_null_rows = has_statistics ? estimate_non_null_rows(stats, filter_attributes) : rows;
+    relation.estimated_size += rows;
+    non_null_rows += source_non_null_rows;
+    distinct_rows += has_statistics ? estimate_distinct_rows(stats, attributes, source_non_null_rows) : source_non_null_rows;
+
+    std::error_code ec;
+    std::uintmax_t size_bytes = std::filesystem::file_size(source, ec);
+    relation.size_bytes += ec ? rows * default_row_bytes : size_bytes;
+
+    // The union of several sources or of the ranges of a split source is not
+    // sorted. A merge join on unsorted input is wrong, so only the order seen
+    // in a full scan is used.
+    if (sources.size() == 1) {
+      scan_node = create_source_scan_node(source);
+      for (const auto &[attribute, column_stats] : stats.columns) {
+        if (stats.complete && scan_node == source && column_stats.sort_order != "none") {
+          relation.sort_orders[attribute] = column_stats.sort_order;
+        }
+      }
+    } else {
+      scan_node += (scan_node.empty() ? "(" : " cup (") + create_source_scan_node(source) + ")";
+    }
+  }
+
+  // Generate projection
+  relation.node = "pi[" + arguments + "](" + scan_node + ")";
+  if (relation.has_statistics) {
+    relation.node = annotate_rows(relation.node, relation.estimated_size);
+    relation.node = annotate_column_facts(relation.node, sources, attributes);
+  }
+
+  std::string filtered_node = create_null_filter_node(filter_arguments, relation.node);
+  if (filtered_node != relation.node) {
+    relation.node = filtered_node;
+    relation.estimated_size = non_null_rows;
+    if (relation.has_statistics) {
+      relation.node = annotate_rows(relation.node, relation.estimated_size);
+    }
+  }
+
+  if (!reduction.key_node.empty()) {
+    relation.estimated_size = std::max(1.0, relation.estimated_size * reduction.selectivity);
+    distinct_rows = std::max(1.0, distinct_rows * reduction.selectivity);
+
+    std::string semi_join_operator = "ltimes [" + reduction.condition + "]";
+    if (relation.has_statistics) {
+      semi_join_operator = annotate_rows(semi_join_operator, relation.estimated_size);
+    }
+    semi_join_operator = annotate_node(semi_join_operator, "filter", reduction.filter);
+    relation.node = "(" + relation.node + ") " + semi_join_operator + " (" + reduction.key_node + ")";
+  }
+
+  if (distinct) {
+    std::string distinct_node = create_distinct_node(relation.node);
+    if (distinct_node != relation.node) {
+      relation.node = distinct_node;
+      relation.sort_orders.clear();  // the distinct operator does not keep the order
+      relation.estimated_size = std::min(relation.estimated_size, distinct_rows);
+      if (relation.has_statistics) {
+        relation.node = annotate_rows(relation.node, relation.estimated_size);
+      }
+    }
+  }
+
+  return relation;
+}
+
+// Child key sets up to this size are applied as exact sets, larger ones as Bloom filters
+const double max_key_set_size = 1 << 20;
+
+// Plans the reduction of the parent rows to those matching a child key. The
+// reduction is only used if the child keys are estimated to keep at most
+// the semi_join_threshold fraction of the parent rows, e.g. for small child
+// sources referencing large master data.
+SemiJoinReduction plan_semi_join_reduction(const std::string &child_source, const std::string &parent_source,
+                                           const std::vector<std::array<std::string, 2>> &join_conditions) {
+  SemiJoinReduction reduction;
+  SourceStatistics child_stats;
+  SourceStatistics parent_stats;
+  if (!g_options.semi_join_reduction || join_conditions.empty() ||
+      !get_source_statistics(child_source, child_stats) || !get_source_statistics(parent_source, parent_stats)) {
+    return reduction;
+  }
+
+  std::vector<std::string> child_keys;
+  std::vector<std::string> parent_keys;
+  for (const auto &join_condition : join_conditions) {
+    child_keys.push_back(join_condition[0]);
+    parent_keys.push_back(join_condition[1]);
+  }
+
+  double child_key_count = estimate_distinct_rows(child_stats, child_keys,
+                                                  estimate_non_null_rows(child_stats, child_keys));
+  double parent_key_count = estimate_distinct_rows(parent_stats, parent_keys,
+                                                   estimate_non_null_rows(parent_stats, parent_keys));
+  double selectivity = std::min(1.0, child_key_count / parent_key_count);
+  if (selectivity > g_options.semi_join_threshold) {
+    return reduction;
+  }
+
+  for (const auto &join_condition : join_conditions) {
+    reduction.condition += (reduction.condition.empty() ? "" : ",") + parent_source + "_" + join_condition[1] +
+                           "=" + child_source + "_" + join_condition[0];
+  }
+  std::set<std::string> unique_child_keys(child_keys.begin(), child_keys.end());
+  reduction.key_node = create_source_relation({child_source}, {unique_child_keys.begin(), unique_child_keys.end()},
+                                              true).node;
+  reduction.filter = child_key_count <= max_key_set_size ? "keys" : "bloom";
+  reduction.selectivity = selectivity;
+  return reduction;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Extracts the referencing object map of a subgraph with a join
+JoinMapping get_join_mapping(const std::vector<NTriple> &triples) {
+  JoinMapping mapping;
 
   // Get root tm
   std::string root_tm = get_root_tm(triples);
 
+  // Get source of the root tm
+  mapping.child_source = get_source(triples, root_tm);
+
   // Get pom
   std::string pom = get_predicate_object_map(triples, root_tm);
 
   // get subject
-  Subject subj = get_subject(triples, root_tm);
+  mapping.subj = get_subject(triples, root_tm);
 
   // get predicate
-  Predicate pred = get_predicate(triples, pom);
+  mapping.pred = get_predicate(triples, pom);
 
   // get object
-  auto [obj, parent_source] = get_object_w_join(triples, pom);
+  std::tie(mapping.obj, mapping.parent_source) = get_object_w_join(triples, pom);
 
   // get graph
-  std::vector<Graph> graphs = get_graph(triples, root_tm, pom);
+  mapping.graphs = get_graph(triples, root_tm, pom);
+
+  return mapping;
+}
 
-  // Get normal source:
-  if (sources.size() > 1) {
-    if (sources[0] != sources[1]) {
-      sources.erase(std::remove(sources.begin(), sources.end(), parent_source), sources.end());
+// Prefixes the attributes of the term maps with their source, as the join
+// output contains the attributes of both sources
+void prefix_join_attributes(JoinMapping &mapping) {
+  // Subject
+  if (mapping.subj.term_map_type == "template") {
+    std::vector<std::string> sub_strings = extract_substrings(mapping.subj.term_map);
+    for (const auto &sub_str : sub_strings) {
+      std::string replacement = std::format("{}_{}", mapping.child_source, sub_str);
+      mapping.subj.term_map = replace_substring(mapping.subj.term_map, "{" + sub_str + "}", "{" + replacement + "}");
     }
+  } else if (mapping.subj.term_map_type == "reference") {
+    std::string replacement = std::format("{}_{}", mapping.child_source, mapping.subj.term_map);
+    mapping.subj.term_map = replacement;
   }
 
-  ///////////////////////////
+  // Predicate
+  if (mapping.pred.term_map_type == "template") {
+    std::vector<std::string> sub_strings = extract_substrings(mapping.pred.term_map);
+    for (const auto &sub_str : sub_strings) {
+      std::string replacement = std::format("{}_{}", mapping.child_source, sub_str);
+      mapping.pred.term_map = replace_substring(mapping.pred.term_map, "{" + sub_str + "}", "{" + replacement + "}");
+    }
+  } else if (mapping.pred.term_map_type == "reference") {
+    std::string replacement = std::format("{}_{}", mapping.child_source, mapping.pred.term_map);
+    mapping.pred.term_map = replacement;
+  }
 
-  // Get projected attributes of input 1
-  Object empty_obj;
-  empty_obj.join_condition = obj.join_condition;  // copy join condition for projection
-  std::vector<std::string> proj_attributes1 = get_projected_attributes(subj, pred, empty_obj);
+  // Object
+  if (mapping.obj.term_map_type == "template") {
+    std::vector<std::string> sub_strings = extract_substrings(mapping.obj.term_map);
+    for (const auto &sub_str : sub_strings) {
+      std::string replacement = std::format("{}_{}", mapping.parent_source, sub_str);
+      mapping.obj.term_map = replace_substring(mapping.obj.term_map, "{" + sub_str + "}", "{" + replacement + "}");
+    }
+  } else if (mapping.obj.term_map_type == "reference") {
+    std::string replacement = std::format("{}_{}", mapping.parent_source, mapping.obj.term_map);
+    mapping.obj.term_map = replacement;
+  }
 
-  // Get projected attributeds of input 2
-  Subject empty_subj;
-  Predicate empty_pred;
-  std::vector<std::string> proj_attributes2 = get_projected_attributes(empty_subj, empty_pred, obj);
+  // Graph
+  for (auto &graph : mapping.graphs) {
+    if (!graph.term_map.empty()) {
+      if (graph.term_map_type == "template") {
+        std::vector<std::string> sub_strings =
+            extract_substrings(graph.term_map);
+        for (const auto &sub_str : sub_strings) {
+          std::string replacement =
+              std::format("{}_{}", mapping.child_source, sub_str);
+          graph.term_map =
+              replace_substring(graph.term_map, "{" + sub_str + "}", "{" + replacement + "}");
+        }
+      } else if (graph.term_map_type == "reference") {
+        std::string replacement =
+            std::format("{}_{}", mapping.child_source, graph.term_map);
+        graph.term_map =
+            replace_substring(graph.term_map, graph.term_map, replacement);
+      }
+    }
+  }
+}
 
-  // Generate Create
+// Creates the create terms of a join mapping, its attributes have to be prefixed
+std::vector<CreateTerm> create_join_terms(const JoinMapping &mapping) {
+  const Subject &subj = mapping.subj;
+  const Predicate &pred = mapping.pred;
+  const Object &obj = mapping.obj;
 
-  // Generate argument string
-  std::string arguments_file1 = "";
-  for (size_t i = 0; i < proj_attributes1.size(); ++i) {
-    arguments_file1 += std::format("{}", proj_attributes1[i]);
-    if (i < proj_attributes1.size() - 1) {
-      arguments_file1 += ",";
-    }
+  std::string subj_create = "create(" + subj.term_map + "," + subj.term_map_type + "," + subj.term_type + ") -> S";
+  std::string pred_create = "create(" + pred.term_map + "," + pred.term_map_type + "," + pred.term_type + ") -> P";
+  std::string obj_create = "create(" + obj.term_map + "," + obj.term_map_type + "," + obj.term_type + "," + obj.lang_tag + "," + obj.data_type + ") -> O";
+
+  return {{subj_create, subj.term_map_type == "constant"},
+          {pred_create, pred.term_map_type == "constant"},
+          {obj_create, obj.term_map_type == "constant"}};
+}
+
+// Reads the attributes of the source records referenced by the row IDs in
+// the input, followed by the null filter on the fetched attributes unless
+// filter is false. The fetched attributes are prefixed with the source like
+// the join output.
+std::string create_fetch_node(const std::string &input_node, const std::string &source,
+                              const std::vector<std::string> &attributes, bool filter = true) {
+  std::string arguments = "";
+  std::string prefixed_arguments = "";
+  for (const auto &attribute : attributes) {
+    arguments += (arguments.empty() ? "" : ",") + attribute;
+    prefixed_arguments += (prefixed_arguments.empty() ? "" : ",") + source + "_" + attribute;
   }
 
-  // Generate projection
-  std::string projection_file1_node = "pi[" + arguments_file1 + "](" + sources[0] + ")";
+  std::string fetch_node = "fetch[" + source + ":" + arguments + "](" + input_node + ")";
+  return filter ? create_null_filter_node(prefixed_arguments, fetch_node) : fetch_node;
+}
 
-  //////////////////////////////////////
+// Creates the null filter of a fork head on the attributes of its terms, it
+// precedes the create list of the head
+std::string create_head_filter(const std::vector<std::string> &attributes) {
+  std::set<std::string> unique_attributes(attributes.begin(), attributes.end());
+  std::string arguments = "";
+  for (const auto &attribute : unique_attributes) {
+    arguments += (arguments.empty() ? "" : ",") + attribute;
+  }
+  if (!g_options.push_null_filters || arguments.empty()) {
+    return "";
+  }
+  return "sigma[not null(" + arguments + ")] ";
+}
 
-  // Generate argument string
-  std::string arguments_file2 = "";
-  for (size_t i = 0; i < proj_attributes2.size(); ++i) {
-    arguments_file2 += std::format("{}", proj_attributes2[i]);
-    if (i < proj_attributes2.size() - 1) {
-      arguments_file2 += ",";
+// Creates the join of all mappings with the same child source, parent source
+// and join condition. A single mapping is emitted as a create projection over
+// the join. Several mappings share the join through a fork[] node, which
+// evaluates each of its create lists (one per mapping and graph) on the join
+// output, so the join is built and probed once. The inputs of a shared join
+// are only null filtered on the join keys, as a row with an empty attribute
+// of one mapping still yields the triples of the others. Each head of the
+// fork filters the attributes of its own mapping instead.
+std::string create_join_group_tree(std::vector<JoinMapping> mappings) {
+  const std::string child_source = mappings[0].child_source;
+  const std::string parent_source = mappings[0].parent_source;
+  const std::string join_type = mappings[0].obj.join_type;
+  const std::vector<std::array<std::string, 2>> join_conditions = mappings[0].obj.join_conditions;
+  bool shared = mappings.size() > 1;
+
+  // The output has no duplicates if every child row yields a different subject
+  // and the matching parent rows of a child row yield different objects. For a
+  // shared join the parent is deduplicated on the attributes of all mappings,
+  // which does not hold anymore.
+  bool unique_output = false;
+  if (!shared) {
+    const JoinMapping &mapping = mappings[0];
+    bool subject_unique = is_key_term(mapping.subj.term_map_type, mapping.subj.term_map, child_source);
+    bool object_unique = is_key_term(mapping.obj.term_map_type, mapping.obj.term_map, parent_source) ||
+                         (g_options.early_distinct && is_injective(mapping.obj.term_map_type, mapping.obj.term_map));
+    unique_output = subject_unique && object_unique;
+  }
+
+  // Get projected attributes of both inputs
+  std::set<std::string> attribute_set1;
+  std::set<std::string> attribute_set2;
+  for (const auto &mapping : mappings) {
+    Object empty_obj;
+    empty_obj.join_conditions = mapping.obj.join_conditions;  // copy join conditions for projection
+    for (const auto &attribute : get_projected_attributes(mapping.subj, mapping.pred, empty_obj, mapping.graphs)) {
+      attribute_set1.insert(attribute);
+    }
+
+    Subject empty_subj;
+    Predicate empty_pred;
+    for (const auto &attribute : get_projected_attributes(empty_subj, empty_pred, mapping.obj)) {
+      attribute_set2.insert(attribute);
+    }
+  }
+  std::vector<std::string> proj_attributes1(attribute_set1.begin(), attribute_set1.end());
+  std::vector<std::string> proj_attributes2(attribute_set2.begin(), attribute_set2.end());
+
+  // A shared join leaves all but the join keys to the null filters of the heads
+  std::set<std::string> unfiltered1;
+  std::set<std::string> unfiltered2;
+  if (shared) {
+    unfiltered1 = attribute_set1;
+    unfiltered2 = attribute_set2;
+    for (const auto &join_condition : join_conditions) {
+      unfiltered1.erase(join_condition[0]);
+      unfiltered2.erase(join_condition[1]);
+    }
+  }
+
+  // With late materialization the parent only carries its join keys and row
+  // IDs through the join, the other attributes are fetched for the joined rows
+  std::vector<std::string> fetch_attributes;
+  if (g_options.late_materialization && join_type != "natural-join") {
+    std::set<std::string> key_attributes;
+    for (const auto &join_condition : join_conditions) {
+      key_attributes.insert(join_condition[1]);
+    }
+
+    std::vector<std::string> join_attributes = {row_id_attribute};
+    for (const auto &attribute : proj_attributes2) {
+      if (key_attributes.contains(attribute)) {
+        join_attributes.push_back(attribute);
+      } else {
+        fetch_attributes.push_back(attribute);
+      }
+    }
+    if (!fetch_attributes.empty()) {
+      validate_references(parent_source, fetch_attributes);
+      proj_attributes2 = join_attributes;
     }
   }
 
-  std::string projection_file2_node = "pi[" + arguments_file2 + "](" + parent_source + ")";
+  // Without the duplicate elimination, only a parent key keeps objects unique
+  if (!fetch_attributes.empty() && unique_output) {
+    const Object &obj = mappings[0].obj;
+    unique_output = is_key_term(obj.term_map_type, obj.term_map, parent_source);
+  }
+
+  // Generate projections, duplicates can not occur with row IDs
+  SemiJoinReduction reduction;
+  if (join_type != "natural-join") {
+    reduction = plan_semi_join_reduction(child_source, parent_source, join_conditions);
+  }
+  JoinRelation relation1 = create_source_relation({child_source}, proj_attributes1, false, {}, unfiltered1);
+  JoinRelation relation2 =
+      create_source_relation({parent_source}, proj_attributes2, fetch_attributes.empty(), reduction, unfiltered2);
 
   //////////////////////////////////////
 
@@ -789,130 +1725,111 @@ std::string create_complex_tree(const std::vector<NTriple> &triples) {
   // 'in_relation': ['i53c2', 'i0d95'], 'out_relation': 'i9008'}
 
   std::string join_node;
-  if (obj.join_type == "natural-join") {
-    join_node = "(" + projection_file1_node + ") bowtie (" + projection_file2_node + ")";
+  double join_rows = relation1.estimated_size;
+  if (join_type == "natural-join") {
+    join_node = "(" + relation1.node + ") bowtie (" + relation2.node + ")";
   } else {
-    join_node = "(" + projection_file1_node + ") bowtie [" + sources[0] + "_" + obj.join_condition[0] + "=" + parent_source + "_" + obj.join_condition[1] + "] (" + projection_file2_node + ")";
+    std::vector<JoinRelation> relations = {relation1, relation2};
+    // All conditions are evaluated as one composite key equi-join
+    std::vector<JoinPredicate> predicates;
+    for (const auto &join_condition : join_conditions) {
+      predicates.push_back({0, join_condition[0], 1, join_condition[1]});
+    }
+    JoinPlan join_plan = create_join_plan(relations, predicates);
+    join_node = join_plan.node;
+    join_rows = join_plan.cardinality;
+  }
+  bool has_statistics = relation1.has_statistics && relation2.has_statistics;
+
+  if (!fetch_attributes.empty()) {
+    join_node = create_fetch_node(join_node, parent_source, fetch_attributes, !shared);
+    if (has_statistics) {
+      join_node = annotate_rows(join_node, join_rows);
+    }
   }
 
   //////////////////////////////////////
 
   // Format elements correctly
-  // Subject
-  if (obj.join_type == "natural-join") {
-  } else {
-    if (subj.term_map_type == "template") {
-      std::vector<std::string> sub_strings = extract_substrings(subj.term_map);
-      for (const auto &sub_str : sub_strings) {
-        std::string replacement = std::format("{}_{}", sources[0], sub_str);
-        subj.term_map = replace_substring(subj.term_map, "{" + sub_str + "}", "{" + replacement + "}");
-      }
-    } else if (subj.term_map_type == "reference") {
-      std::string replacement = std::format("{}_{}", sources[0], subj.term_map);
-      subj.term_map = replace_substring(subj.term_map, "{" + subj.term_map + "}", "{" + replacement + "}");
+  if (join_type != "natural-join") {
+    for (auto &mapping : mappings) {
+      prefix_join_attributes(mapping);
     }
+  }
 
-    // Predicate
-    if (pred.term_map_type == "template") {
-      std::vector<std::string> sub_strings = extract_substrings(pred.term_map);
-      for (const auto &sub_str : sub_strings) {
-        std::string replacement = std::format("{}_{}", sources[0], sub_str);
-        pred.term_map = replace_substring(pred.term_map, "{" + sub_str + "}", "{" + replacement + "}");
+  if (shared) {
+    // Constant terms are not hoisted out of the heads, the grammar has no
+    // bind[] per head. They are created per joined row like the others.
+    std::string heads = "";
+    size_t num_heads = 0;
+    for (const auto &mapping : mappings) {
+      std::string terms_str = "";
+      for (const auto &term : create_join_terms(mapping)) {
+        terms_str += (terms_str.empty() ? "" : ",") + term.expression;
       }
-    } else if (pred.term_map_type == "reference") {
-      std::string replacement = std::format("{}_{}", sources[0], pred.term_map);
-      pred.term_map = replace_substring(pred.term_map, "{" + pred.term_map + "}", "{" + replacement + "}");
-    }
 
-    // Object
-    if (obj.term_map_type == "template") {
-      std::vector<std::string> sub_strings = extract_substrings(obj.term_map);
-      for (const auto &sub_str : sub_strings) {
-        std::string replacement = std::format("{}_{}", parent_source, sub_str);
-        obj.term_map = replace_substring(obj.term_map, "{" + sub_str + "}", "{" + replacement + "}");
-      }
-    } else if (obj.term_map_type == "reference") {
-      std::string replacement = std::format("{}_{}", parent_source, obj.term_map);
-      obj.term_map = replace_substring(obj.term_map, "{" + obj.term_map + "}", "{" + replacement + "}");
-    }
-
-    // Graph
-    for (auto &graph : graphs) {
-      if (!graph.term_map.empty()) {
-        if (graph.term_map_type == "template") {
-          std::vector<std::string> sub_strings =
-              extract_substrings(graph.term_map);
-          for (const auto &sub_str : sub_strings) {
-            std::string replacement =
-                std::format("{}_{}", sources[0], sub_str);
-            graph.term_map =
-                replace_substring(graph.term_map, sub_str, replacement);
-          }
-        } else if (graph.term_map_type == "reference") {
-          std::string replacement =
-              std::format("{}_{}", sources[0], graph.term_map);
-          graph.term_map =
-              replace_substring(graph.term_map, graph.term_map, replacement);
+      // The attributes of the terms are already prefixed like the join output
+      Object obj = mapping.obj;
+      obj.join_conditions.clear();
+      std::vector<std::string> term_attributes = get_projected_attributes(mapping.subj, mapping.pred, obj);
+
+      bool has_graph = false;
+      for (const auto &graph : mapping.graphs) {
+        if (graph.term_map.empty()) {
+          continue;
         }
+        has_graph = true;
+        std::vector<std::string> graph_attributes =
+            get_projected_attributes(Subject(), Predicate(), Object(), {graph});
+        graph_attributes.insert(graph_attributes.end(), term_attributes.begin(), term_attributes.end());
+        heads += (num_heads++ > 0 ? ";" : "") + create_head_filter(graph_attributes) + terms_str + ",create(" +
+                 graph.term_map + "," + graph.term_map_type + "," + graph.term_type + ") -> G";
+      }
+      if (!has_graph) {
+        heads += (num_heads++ > 0 ? ";" : "") + create_head_filter(term_attributes) + terms_str;
       }
     }
-  }
 
-  // Generate create projection
-  std::string subj_create = "create(" + subj.term_map + "," + subj.term_map_type + "," + subj.term_type + ") -> S";
-  std::string pred_create = "create(" + pred.term_map + "," + pred.term_map_type + "," + pred.term_type + ") -> P";
-  std::string obj_create = "create(" + obj.term_map + "," + obj.term_map_type + "," + obj.term_type + "," + obj.lang_tag + "," + obj.data_type + ") -> O";
-
-  std::string graph_create1 = "";
-  std::string graph_create2 = "";
-  if (graphs.size() == 1) {
-    if (!graphs[0].term_map.empty()) {
-      graph_create1 = "create(" + graphs[0].term_map + "," + graphs[0].term_map_type + "," + graphs[0].term_type + ") -> G";
-    }
-  } else if (graphs.size() == 2) {
-    if (!graphs[0].term_map.empty()) {
-      graph_create1 = "create(" + graphs[0].term_map + "," + graphs[0].term_map_type + "," + graphs[0].term_type + ") -> G";
-    }
-    if (!graphs[1].term_map.empty()) {
-      graph_create2 = "create(" + graphs[1].term_map + "," + graphs[1].term_map_type + "," + graphs[1].term_type + ") -> G";
+    std::string fork_node = "fork[" + heads + "](" + join_node + ")";
+    if (has_statistics) {
+      fork_node = annotate_rows(fork_node, join_rows * num_heads);
     }
+    return fork_node + "\n";
   }
 
-  std::vector<std::string> proj_nodes;
-  if (!graph_create1.empty()) {
-    std::string create_projection_node;
-    create_projection_node = "pi[" + subj_create + "," + pred_create + "," + obj_create + "," + graph_create1 + "]";
-    proj_nodes.push_back(create_projection_node);
-  } 
-  
-  if (!graph_create2.empty()) {
-    std::string create_projection_node;
-    create_projection_node = "pi[" + subj_create + "," + pred_create + "," + obj_create + "," + graph_create2 + "]";
-    proj_nodes.push_back(create_projection_node);
-  } 
-  
-  if (graph_create1.empty() && graph_create2.empty()) {
-    std::string create_projection_node;
-    create_projection_node = "pi[" + subj_create + "," + pred_create + "," + obj_create + "]";
-    proj_nodes.push_back(create_projection_node);
-  }
+  std::vector<std::string> proj_nodes =
+      create_projection_nodes(create_join_terms(mappings[0]), mappings[0].graphs, join_node);
 
   // Generate final result
   std::string final_result = "";
-  for (const auto& proj_node : proj_nodes){
-  std::string result = proj_node + "(" + join_node + ")";
-  final_result += result + "\n";
+  for (auto proj_node : proj_nodes) {
+    if (has_statistics) {
+      proj_node = annotate_rows(proj_node, join_rows);
+    }
+    if (unique_output) {
+      proj_node = annotate_node(proj_node, "dedup", "false");
+    }
+    final_result += proj_node + "\n";
   }
 
   return final_result;
 }
 
-std::string create_simple_tree(const std::vector<NTriple> &triples) {
+std::string create_complex_tree(const std::vector<NTriple> &triples) {
+  return create_join_group_tree({get_join_mapping(triples)});
+}
+
+// Sources lists the sources of all mappings sharing this plan, if empty the
+// source of the mapping is used
+std::string create_simple_tree(const std::vector<NTriple> &triples, std::vector<std::string> sources) {
   /////////////////////
   std::vector<std::string> final_result;
   /////////////////////
   // Get source
   std::string source = find_matching_objects(triples, "", "http://semweb.mmlab.be/ns/rml#source")[0];
+  if (sources.empty()) {
+    sources = {source};
+  }
 
   // Get root tm
   std::string root_tm = get_root_tm(triples);
@@ -935,69 +1852,57 @@ std::string create_simple_tree(const std::vector<NTriple> &triples) {
   ///////////////////////////
 
   // Get projected attributes
-  std::vector<std::string> proj_attributes = get_projected_attributes(subj, pred, obj);
-
-  // Generate Create //
-
-  // Generate argument string
-  std::string arguments = "";
-  for (size_t i = 0; i < proj_attributes.size(); ++i) {
-    arguments += std::format("{}", proj_attributes[i]);
-    if (i < proj_attributes.size() - 1) {
-      arguments += ",";
-    }
-  }
+  std::vector<std::string> proj_attributes = get_projected_attributes(subj, pred, obj, graphs);
 
   // Generate projection
-  std::string projection_node = "pi[" + arguments + "](" + source + ")";
+  JoinRelation relation = create_source_relation(sources, proj_attributes, false);
+  std::string projection_node = relation.node;
 
   // Generate create projection
-  std::string create_val = "pi[create(" + subj.term_map + "," + subj.term_map_type + "," + subj.term_type + ") -> S," +
-                           "create(" + pred.term_map + "," + pred.term_map_type + "," + pred.term_type + ") -> P," +
-                           "create(" + obj.term_map + "," + obj.term_map_type + "," + obj.term_type + "," + obj.lang_tag + "," + obj.data_type + ") -> O";
-
-  if (graphs.size() == 1 && !graphs[0].term_map.empty()) {
-    create_val += ", create(" + graphs[0].term_map + "," + graphs[0].term_map_type + "," + graphs[0].term_type + ") -> G]";
-
-    std::string res = create_val + "(" + projection_node + ")";
-    final_result.push_back(res);
-  } else if (graphs.size() == 2) {
-    std::string create_val_1 = create_val;
-    std::string create_val_2 = create_val;
+  std::string subj_create = "create(" + subj.term_map + "," + subj.term_map_type + "," + subj.term_type + ") -> S";
+  std::string pred_create = "create(" + pred.term_map + "," + pred.term_map_type + "," + pred.term_type + ") -> P";
+  std::string obj_create = "create(" + obj.term_map + "," + obj.term_map_type + "," + obj.term_type + "," + obj.lang_tag + "," + obj.data_type + ") -> O";
 
-    create_val_1 += ", create(" + graphs[0].term_map + "," + graphs[0].term_map_type + "," + graphs[0].term_type + ") -> G]";
-    create_val_2 += ", create(" + graphs[1].term_map + "," + graphs[1].term_map_type + "," + graphs[1].term_type + ") -> G]";
+  std::vector<CreateTerm> terms = {{subj_create, subj.term_map_type == "constant"},
+                                   {pred_create, pred.term_map_type == "constant"},
+                                   {obj_create, obj.term_map_type == "constant"}};
 
-    std::string res1 = create_val_1 + "(" + projection_node + ")";
-    final_result.push_back(res1);
+  final_result = create_projection_nodes(terms, graphs, projection_node);
 
-    std::string res2 = create_val_2 + "(" + projection_node + ")";
-    final_result.push_back(res2);
-  } else {
-    create_val += "]";
-    std::string res = create_val + "(" + projection_node + ")";
-    final_result.push_back(res);
-  }
+  // A term over a declared key yields a different triple for every row,
+  // the union of several sources can still repeat the key
+  bool unique_output = sources.size() == 1 &&
+                       (is_key_term(subj.term_map_type, subj.term_map, source) ||
+                        is_key_term(pred.term_map_type, pred.term_map, source) ||
+                        is_key_term(obj.term_map_type, obj.term_map, source));
 
   std::string res_str = "";
-  for (const auto &result : final_result) {
+  for (auto result : final_result) {
+    if (relation.has_statistics) {
+      // A plan of constant terms creates its triple for the first row only
+      bool limited = result.find("limit[1](") != std::string::npos;
+      result = annotate_rows(result, limited ? std::min(1.0, relation.estimated_size) : relation.estimated_size);
+    }
+    if (unique_output) {
+      result = annotate_node(result, "dedup", "false");
+    }
     res_str += result + "\n";
   }
 
   return res_str;
 }
 
-std::string converter(const std::vector<NTriple> &triples) {
-  // Check if with join, i.e. two subj. maps
+std::string converter(const std::vector<NTriple> &triples, const std::vector<std::string> &sources) {
+  // Check if with join, i.e. two or more subj. maps
   std::vector<std::string> subject_nodes = find_matching_objects(triples, "", "http://www.w3.org/ns/r2rml#subjectMap");
   // Handle join
-  if (subject_nodes.size() == 2) {
+  if (subject_nodes.size() >= 2) {
     std::string result = create_complex_tree(triples);
     return result;
   }
 
   // Handle without join
-  std::string results = create_simple_tree(triples);
+  std::string results = create_simple_tree(triples, sources);
   return results;
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1037,6 +1942,512 @@ std::vector<NTriple> rdf_string_to_vector(const std::string &rdf_string) {
   return triples;
 }
 
+// Function to split the normalizer output into its subgraphs
+std::vector<std::string> split_sub_graphs(const std::string &normalized_mapping) {
+  const std::string separator = "====";
+  std::vector<std::string> sub_graphs;
+
+  size_t start = 0;
+  while (start < normalized_mapping.size()) {
+    size_t end = normalized_mapping.find(separator, start);
+    if (end == std::string::npos) {
+      end = normalized_mapping.size();
+    }
+
+    // Trim surrounding whitespace and skip empty subgraphs
+    size_t first = normalized_mapping.find_first_not_of(" \t\r\n", start);
+    if (first != std::string::npos && first < end) {
+      size_t last = normalized_mapping.find_last_not_of(" \t\r\n", end - 1);
+      sub_graphs.push_back(normalized_mapping.substr(first, last - first + 1));
+    }
+
+    start = end + separator.size();
+  }
+
+  return sub_graphs;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Batch conversion
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Runs task(i) for i in [0, count) on a pool of num_threads workers and
+// rethrows the exception of the first failing task
+void parallel_for(size_t count, unsigned int num_threads, const std::function<void(size_t)> &task) {
+  std::vector<std::exception_ptr> errors(count);
+  std::atomic<size_t> next_index{0};
+
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next_index.fetch_add(1)) < count) {
+      try {
+        task(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min<size_t>(num_threads, std::max<size_t>(1, count));
+
+  std::vector<std::thread> pool;
+  for (unsigned int t = 1; t < num_threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Returns true if the subgraph joins a child with a parent triples map
+bool is_join_sub_graph(const std::vector<NTriple> &triples) {
+  return find_matching_objects(triples, "", "http://www.w3.org/ns/r2rml#subjectMap").size() >= 2;
+}
+
+// Returns the key of the join a mapping is evaluated on, mappings with the
+// same key can share the join. Returns "" for natural joins, as their join
+// attributes depend on the projected attributes.
+std::string join_group_key(const JoinMapping &mapping) {
+  if (mapping.obj.join_type == "natural-join") {
+    return "";
+  }
+  std::string key = "join\t" + mapping.child_source + "\t" + mapping.parent_source;
+  for (const auto &join_condition : mapping.obj.join_conditions) {
+    key += "\t" + join_condition[0] + "=" + join_condition[1];
+  }
+  return key;
+}
+
+// Returns the structure of a join-free subgraph with its nodes numbered in
+// order of appearance and its source masked, so mappings that only differ in
+// node names and source get the same key. A constant term is kept even if it
+// names a node, e.g. a triples map that is its own subject. Returns "" for
+// subgraphs that cannot share a plan.
+std::string canonical_sub_graph_key(const std::vector<NTriple> &triples) {
+  const std::string source_predicate = "http://semweb.mmlab.be/ns/rml#source";
+  const std::string constant_predicate = "http://www.w3.org/ns/r2rml#constant";
+
+  size_t num_sources = 0;
+  size_t num_subject_maps = 0;
+  std::unordered_map<std::string, std::string> node_names;
+  for (const auto &triple : triples) {
+    if (triple.predicate == source_predicate) {
+      num_sources++;
+    } else if (triple.predicate == "http://www.w3.org/ns/r2rml#subjectMap") {
+      num_subject_maps++;
+    } else if (triple.predicate == "http://www.w3.org/ns/r2rml#parentTriplesMap") {
+      return "";
+    }
+    if (!node_names.contains(triple.subject)) {
+      node_names[triple.subject] = "?" + std::to_string(node_names.size());
+    }
+  }
+  if (num_sources != 1 || num_subject_maps != 1) {
+    return "";
+  }
+
+  std::vector<std::string> lines;
+  lines.reserve(triples.size());
+  for (const auto &triple : triples) {
+    std::string object = triple.object;
+    if (triple.predicate == source_predicate) {
+      object = "?source";
+    } else if (triple.predicate != constant_predicate && node_names.contains(object)) {
+      object = node_names[object];
+    }
+    lines.push_back(node_names[triple.subject] + "|||" + triple.predicate + "|||" + object);
+  }
+  std::sort(lines.begin(), lines.end());
+
+  std::string key;
+  for (const auto &line : lines) {
+    key += line + "\n";
+  }
+  return key;
+}
+
+// Estimates the cost of a plan from the bytes of its sources, every join is
+// assumed to process the input once more. A plan of constant terms only reads
+// the first row of its sources.
+double estimate_plan_cost(const std::string &plan, const std::vector<std::string> &sources) {
+  if (plan.find("limit[1](") != std::string::npos) {
+    return std::max(1.0, sources.size() * default_row_bytes);
+  }
+
+  double bytes = 0;
+  for (const auto &source : sources) {
+    std::error_code ec;
+    std::uintmax_t size_bytes = std::filesystem::file_size(source, ec);
+    bytes += ec ? default_source_rows * default_row_bytes : size_bytes;
+  }
+
+  size_t joins = 0;
+  for (size_t pos = plan.find("bowtie "); pos != std::string::npos; pos = plan.find("bowtie ", pos + 1)) {
+    joins++;
+  }
+
+  return std::max(1.0, bytes * (1 + joins));
+}
+
+// Orders the plans longest processing time first, so the largest plans do
+// not start last and leave the other workers idle at the end of a run. Ties
+// are ordered lexically, so the order does not depend on the conversion.
+// Plans measured in a previous run use their measured time instead of the
+// estimate. It is converted to cost units with the ratio of measured time
+// to estimated cost over all measured plans, so both kinds stay comparable.
+// Every plan is annotated with its cost for the scheduler, and measured
+// plans also with their previous time and triple count.
+std::string order_plans(const std::vector<std::string> &plans, const std::vector<std::vector<std::string>> &sources) {
+  struct PlanEntry {
+    std::string plan;
+    double cost;
+    bool measured;
+    PlanTimings timings;
+  };
+
+  g_plan_profile.refresh();
+
+  std::vector<PlanEntry> entries;
+  double measured_seconds = 0;
+  double measured_cost = 0;
+  for (size_t g = 0; g < plans.size(); ++g) {
+    std::istringstream stream(plans[g]);
+    std::string plan;
+    while (std::getline(stream, plan)) {
+      if (plan.empty()) {
+        continue;
+      }
+      PlanEntry entry{plan, estimate_plan_cost(plan, sources[g]), false, {}};
+      entry.measured = g_plan_profile.get(plan_fingerprint(plan), entry.timings);
+      if (entry.measured) {
+        measured_seconds += entry.timings.seconds;
+        measured_cost += entry.cost;
+      }
+      entries.push_back(entry);
+    }
+  }
+
+  if (measured_seconds > 0 && measured_cost > 0) {
+    double cost_per_second = measured_cost / measured_seconds;
+    for (auto &entry : entries) {
+      if (entry.measured) {
+        entry.cost = entry.timings.seconds * cost_per_second;
+      }
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+    return a.cost != b.cost ? a.cost > b.cost : a.plan < b.plan;
+  });
+
+  std::string result;
+  for (const auto &entry : entries) {
+    std::string plan = annotate_node(entry.plan, "cost", std::to_string(std::llround(entry.cost)));
+    if (entry.measured) {
+      plan = annotate_node(plan, "profile_ms", std::to_string(std::llround(entry.timings.seconds * 1000)));
+      plan = annotate_node(plan, "profile_triples", std::to_string(std::llround(entry.timings.triples)));
+    }
+    result += plan + "\n";
+  }
+  return result;
+}
+
+// Returns the text of a subgraph as written by the normalizer, without the
+// trailing newline
+std::string sub_graph_text(const std::vector<NTriple> &triples) {
+  std::string text;
+  for (const auto &triple : triples) {
+    if (!text.empty()) {
+      text += "\n";
+    }
+    text += triple.subject + "|||" + triple.predicate + "|||" + triple.object;
+  }
+  return text;
+}
+
+void sort_sub_graphs(std::vector<std::vector<NTriple>> &sub_graphs) {
+  std::vector<std::string> texts;
+  texts.reserve(sub_graphs.size());
+  for (const auto &sub_graph : sub_graphs) {
+    texts.push_back(sub_graph_text(sub_graph));
+  }
+
+  std::vector<size_t> order(sub_graphs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return texts[a] < texts[b]; });
+
+  std::vector<std::vector<NTriple>> sorted;
+  sorted.reserve(sub_graphs.size());
+  for (size_t i : order) {
+    sorted.push_back(std::move(sub_graphs[i]));
+  }
+  sub_graphs = std::move(sorted);
+}
+
+// Parses the subgraphs on a pool of num_threads workers, in lexical order
+std::vector<std::vector<NTriple>> parse_sub_graphs(std::vector<std::string> sub_graphs, unsigned int num_threads) {
+  std::sort(sub_graphs.begin(), sub_graphs.end());
+
+  std::vector<std::vector<NTriple>> parsed(sub_graphs.size());
+  parallel_for(sub_graphs.size(), num_threads, [&](size_t i) { parsed[i] = rdf_string_to_vector(sub_graphs[i]); });
+  return parsed;
+}
+
+// Returns the key of a group in a plan memo, i.e. the hash of the text of its
+// subgraphs and of the size and modification time of its sources
+std::string plan_memo_key(const std::vector<std::vector<NTriple>> &sub_graphs, const std::vector<size_t> &members,
+                          const std::vector<std::string> &sources) {
+  std::string material;
+  for (size_t member : members) {
+    material += sub_graph_text(sub_graphs[member]) + "\n====\n";
+  }
+  for (const auto &source : sources) {
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(source, ec);
+    int64_t mtime = 0;
+    get_file_mtime(source, mtime);
+    material += source + "\t" + (ec ? "-1" : std::to_string(size)) + "\t" + std::to_string(mtime) + "\n";
+  }
+  return std::to_string(hash_value(material)) + "/" + std::to_string(material.size());
+}
+
+// Converts all subgraphs on a pool of num_threads workers.
+// The plans are ordered by their estimated cost, or concatenated in the
+// order of the subgraphs without cost ordering, so the result does
+// not depend on the number of threads. Subgraphs with the same
+// canonical key are converted once, as a plan over the union of their sources,
+// and subgraphs joining the same sources on the same condition share the join.
+// With a memo, groups converted by the previous conversion are not converted again.
+std::string convert_sub_graphs(const std::vector<std::vector<NTriple>> &sub_graphs, unsigned int num_threads,
+                               PlanMemo *memo) {
+  std::vector<std::string> keys(sub_graphs.size());
+  std::vector<JoinMapping> join_mappings(sub_graphs.size());
+  parallel_for(sub_graphs.size(), num_threads, [&](size_t i) {
+    if (is_join_sub_graph(sub_graphs[i])) {
+      if (g_options.share_joins) {
+        join_mappings[i] = get_join_mapping(sub_graphs[i]);
+        keys[i] = join_group_key(join_mappings[i]);
+      }
+    } else if (g_options.group_identical_maps) {
+      keys[i] = canonical_sub_graph_key(sub_graphs[i]);
+    }
+  });
+
+  // Group by key, each group is converted at the position of its first subgraph
+  std::vector<std::vector<size_t>> group_members;
+  std::unordered_map<std::string, size_t> groups;
+  for (size_t i = 0; i < sub_graphs.size(); ++i) {
+    if (!keys[i].empty()) {
+      auto it = groups.find(keys[i]);
+      if (it != groups.end()) {
+        group_members[it->second].push_back(i);
+        continue;
+      }
+      groups[keys[i]] = group_members.size();
+    }
+    group_members.push_back({i});
+  }
+
+  // All sources read by a group, including the parent sources of joins
+  std::vector<std::vector<std::string>> group_sources(group_members.size());
+  if (g_options.cost_ordering || memo != nullptr) {
+    for (size_t g = 0; g < group_members.size(); ++g) {
+      std::set<std::string> sources;
+      for (size_t member : group_members[g]) {
+        for (const auto &source : find_matching_objects(sub_graphs[member], "", "http://semweb.mmlab.be/ns/rml#source")) {
+          sources.insert(source);
+        }
+      }
+      group_sources[g] = {sources.begin(), sources.end()};
+    }
+  }
+
+  std::vector<std::string> memo_keys(group_members.size());
+  std::vector<std::string> plans(group_members.size());
+  parallel_for(group_members.size(), num_threads, [&](size_t g) {
+    const std::vector<size_t> &members = group_members[g];
+    if (memo != nullptr) {
+      memo_keys[g] = plan_memo_key(sub_graphs, members, group_sources[g]);
+      auto it = memo->plans.find(memo_keys[g]);
+      if (it != memo->plans.end()) {
+        plans[g] = it->second;
+        return;
+      }
+    }
+
+    if (members.size() == 1) {
+      plans[g] = converter(sub_graphs[members[0]]);
+    } else if (is_join_sub_graph(sub_graphs[members[0]])) {
+      std::vector<JoinMapping> mappings;
+      for (size_t member : members) {
+        mappings.push_back(join_mappings[member]);
+      }
+      plans[g] = create_join_group_tree(mappings);
+    } else {
+      std::vector<std::string> sources;
+      for (size_t member : members) {
+        std::string source = find_matching_objects(sub_graphs[member], "", "http://semweb.mmlab.be/ns/rml#source")[0];
+        if (std::find(sources.begin(), sources.end(), source) == sources.end()) {
+          sources.push_back(source);
+        }
+      }
+      plans[g] = converter(sub_graphs[members[0]], sources);
+    }
+  });
+
+  if (memo != nullptr) {
+    // Only the groups of this conversion are kept
+    std::unordered_map<std::string, std::string> memo_plans;
+    memo->reused = 0;
+    for (size_t g = 0; g < group_members.size(); ++g) {
+      memo->reused += memo->plans.contains(memo_keys[g]);
+      memo_plans[memo_keys[g]] = plans[g];
+    }
+    memo->converted = group_members.size() - memo->reused;
+    memo->plans = std::move(memo_plans);
+  }
+
+  if (g_options.cost_ordering) {
+    return order_plans(plans, group_sources);
+  }
+
+  size_t total_size = 0;
+  for (const auto &plan : plans) {
+    total_size += plan.size();
+  }
+
+  std::string result;
+  result.reserve(total_size);
+  for (const auto &plan : plans) {
+    result += plan;
+  }
+
+  return result;
+}
+
+void save_caches() {
+  g_statistics.save();
+  g_split_points.save();
+}
+
+void reset_converter_options() {
+  g_requested_options = ConverterOptions();
+  g_options = effective_options(g_requested_options);
+}
+
+// Sets a boolean option, returns 1 unless the value is "true" or "false"
+int set_flag(bool &flag, const std::string &value) {
+  if (value != "true" && value != "false") {
+    return 1;
+  }
+  flag = value == "true";
+  return 0;
+}
+
+// Sets a requested converter option, returns 0 on success and 1 for an
+// unknown option or an invalid value
+int set_requested_option(const std::string &option, const std::string &value) {
+  if (option == "extended_grammar") {
+    return set_flag(g_requested_options.extended_grammar, value);
+  }
+
+  if (option == "materialize_constants") {
+    return set_flag(g_requested_options.materialize_constants, value);
+  }
+  if (option == "push_null_filters") {
+    return set_flag(g_requested_options.push_null_filters, value);
+  }
+  if (option == "early_distinct") {
+    return set_flag(g_requested_options.early_distinct, value);
+  }
+  if (option == "group_identical_maps") {
+    return set_flag(g_requested_options.group_identical_maps, value);
+  }
+  if (option == "validate_references") {
+    return set_flag(g_requested_options.validate_references, value);
+  }
+  if (option == "share_joins") {
+    return set_flag(g_requested_options.share_joins, value);
+  }
+  if (option == "late_materialization") {
+    return set_flag(g_requested_options.late_materialization, value);
+  }
+  if (option == "join_hints") {
+    return set_flag(g_requested_options.join_hints, value);
+  }
+  if (option == "broadcast_threshold") {
+    try {
+      g_requested_options.broadcast_threshold = std::stod(value);
+    } catch (const std::exception &) {
+      return 1;
+    }
+    return 0;
+  }
+  if (option == "cost_ordering") {
+    return set_flag(g_requested_options.cost_ordering, value);
+  }
+  if (option == "semi_join_reduction") {
+    return set_flag(g_requested_options.semi_join_reduction, value);
+  }
+  if (option == "semi_join_threshold") {
+    try {
+      g_requested_options.semi_join_threshold = std::stod(value);
+    } catch (const std::exception &) {
+      return 1;
+    }
+    return 0;
+  }
+  if (option == "split_size") {
+    try {
+      g_requested_options.split_size = std::stoull(value);
+    } catch (const std::exception &) {
+      return 1;
+    }
+    return 0;
+  }
+  if (option == "split_points_cache") {
+    g_split_points.set_cache_path(value);
+    return 0;
+  }
+  if (option == "plan_profile") {
+    g_plan_profile.set_profile_path(value);
+    return 0;
+  }
+  if (option == "statistics") {
+    return set_flag(g_requested_options.statistics, value);
+  }
+  if (option == "statistics_catalog") {
+    g_statistics.set_catalog_path(value);
+    return 0;
+  }
+  if (option == "unique_keys") {
+    // Format: source:attribute;source:attribute
+    g_requested_options.unique_keys.clear();
+    std::istringstream stream(value);
+    std::string key;
+    while (std::getline(stream, key, ';')) {
+      size_t pos = key.rfind(':');
+      if (pos == std::string::npos) {
+        return 1;
+      }
+      g_requested_options.unique_keys[key.substr(0, pos)].insert(key.substr(pos + 1));
+    }
+    return 0;
+  }
+
+  return 1;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 extern "C" {
@@ -1050,14 +2461,55 @@ const char *create_relational_algebra(const char *rml_input) {
   // Clear the global result string
   g_result_str.clear();
 
-  g_result_str = converter(rdf_vector);
+  try {
+    g_result_str = converter(rdf_vector);
+    save_caches();
+  } catch (const std::exception &e) {
+    g_result_str = "Error: " + std::string(e.what());
+  }
+
+  // Return result as a C-string
+  return g_result_str.c_str();
+}
+
+// Converts the complete normalizer output in one call, num_threads = 0 uses all cores
+const char *create_relational_algebra_batch(const char *normalized_mapping, int num_threads) {
+  try {
+    unsigned int threads = num_threads < 0 ? 0 : num_threads;
+    std::vector<std::vector<NTriple>> sub_graphs = parse_sub_graphs(split_sub_graphs(normalized_mapping), threads);
+
+    g_result_str.clear();
+    g_result_str = convert_sub_graphs(sub_graphs, threads);
+    save_caches();
+  } catch (const std::exception &e) {
+    g_result_str = "Error: " + std::string(e.what());
+  }
 
   // Return result as a C-string
   return g_result_str.c_str();
 }
 
+// Records the measured execution of a plan as emitted by the converter
+void record_plan_profile(const char *plan, double seconds, long long triples) {
+  g_plan_profile.record(plan_fingerprint(plan), seconds, triples);
+}
+
+void save_plan_profile() {
+  g_plan_profile.save();
+}
+
+// Sets a converter option, returns 0 on success and 1 for an unknown option
+// or an invalid value
+int set_converter_option(const char *key, const char *value) {
+  int result = set_requested_option(key, value);
+  g_options = effective_options(g_requested_options);
+  return result;
+}
+
 void converter_free(char *ptr) {
   delete[] ptr;
 }
 
-}  // extern "C"
\ No newline at end of file
+}  // extern "C"
+
+}  // namespace ra_converter
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef RA_CONVERTER_RML_IO_H
+#define RA_CONVERTER_RML_IO_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../rdf_parser/definitions.h"
+
+namespace ra_converter {
+
+// Converts a single normalized subgraph into its plans, one per line. With
+// sources, the plan reads the union of these sources instead of the source
+// of the subgraph. Throws std::exception on invalid mappings.
+std::string converter(const std::vector<NTriple>& triples, const std::vector<std::string>& sources = {});
+
+// Orders normalized subgraphs lexically by their text, like the batch entry point does
+void sort_sub_graphs(std::vector<std::vector<NTriple>>& sub_graphs);
+
+// Plans of the subgraph groups of a previous conversion. A conversion with a
+// memo reuses the plans of groups whose subgraphs and sources are unchanged
+// and keeps the groups it converted. Only valid for unchanged options.
+struct PlanMemo {
+  std::unordered_map<std::string, std::string> plans;  // group key -> plans
+  size_t reused = 0;                                   // groups reused by the last conversion
+  size_t converted = 0;                                // groups converted by the last conversion
+};
+
+// Converts sorted normalized subgraphs into plans, one per line.
+// num_threads = 0 uses all cores. Throws std::exception on invalid mappings.
+std::string convert_sub_graphs(const std::vector<std::vector<NTriple>>& sub_graphs, unsigned int num_threads,
+                               PlanMemo* memo = nullptr);
+
+// Persists the statistics catalog and the split point cache
+void save_caches();
+
+// Restores the default options, the paths of the caches are kept
+void reset_converter_options();
+
+extern "C" {
+// Sets a converter option, returns 0 on success and 1 for an unknown option
+int set_converter_option(const char* key, const char* value);
+
+// Records the measured execution of a plan as emitted by the converter
+void record_plan_profile(const char* plan, double seconds, long long triples);
+void save_plan_profile();
+}  // extern "C"
+
+}  // namespace ra_converter
+
+#endif
@@ -0,0 +1,254 @@
+#include "source_splitter.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "source_statistics.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Split point computation
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the position after the first record boundary at or after begin,
+// given the quote parity at begin, or size if there is none
+uint64_t find_record_boundary(const char* data, uint64_t begin, uint64_t size, bool in_quotes) {
+  for (uint64_t pos = begin; pos < size; ++pos) {
+    if (data[pos] == '"') {
+      in_quotes = !in_quotes;
+    } else if (data[pos] == '\n' && !in_quotes) {
+      return pos + 1;
+    }
+  }
+  return size;
+}
+
+bool compute_split_points(const std::string& path, uint64_t split_size, SplitPoints& result) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return false;
+  }
+  uint64_t size = file_stat.st_size;
+
+  result.size = size;
+  result.split_size = split_size;
+  result.offsets.clear();
+
+  if (size == 0) {
+    close(fd);
+    result.header_end = 0;
+    result.offsets = {0, 0};
+    return true;
+  }
+
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  const char* data = static_cast<const char*>(mapping);
+
+  result.header_end = find_record_boundary(data, 0, size, false);
+  uint64_t body_size = size - result.header_end;
+  uint64_t num_splits = split_size == 0 ? 1 : std::max<uint64_t>(1, (body_size + split_size - 1) / split_size);
+
+  // Evenly spaced targets, segment i is [targets[i], targets[i + 1])
+  std::vector<uint64_t> targets(num_splits + 1);
+  for (uint64_t i = 0; i <= num_splits; ++i) {
+    targets[i] = result.header_end + body_size / num_splits * i;
+  }
+  targets[num_splits] = size;
+
+  // Count the quotes of each segment in parallel, their parity gives the
+  // quote state at the start of the next segment
+  std::vector<uint64_t> quote_counts(num_splits, 0);
+  unsigned int num_threads = std::max(1u, std::min<unsigned int>(num_splits, std::thread::hardware_concurrency()));
+  std::vector<std::thread> pool;
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    pool.emplace_back([&, t]() {
+      for (uint64_t i = t; i < num_splits; i += num_threads) {
+        quote_counts[i] = std::count(data + targets[i], data + targets[i + 1], '"');
+      }
+    });
+  }
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  result.offsets.push_back(result.header_end);
+  bool in_quotes = false;
+  for (uint64_t i = 1; i < num_splits; ++i) {
+    in_quotes ^= quote_counts[i - 1] % 2 == 1;
+    uint64_t boundary = find_record_boundary(data, targets[i], size, in_quotes);
+    // A record longer than a split can swallow the following targets
+    if (boundary > result.offsets.back() && boundary < size) {
+      result.offsets.push_back(boundary);
+    }
+  }
+  result.offsets.push_back(size);
+
+  munmap(mapping, size);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Split point cache
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SplitPointCache::set_cache_path(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (path != cache_path) {
+    cache_path = path;
+    entries.clear();
+    loaded = false;
+    modified = false;
+  }
+}
+
+// Format:
+//   path <tab> mtime <tab> size <tab> split size <tab> header end <tab> offset,offset,...
+void SplitPointCache::load() {
+  loaded = true;
+  if (cache_path.empty()) {
+    return;
+  }
+
+  std::ifstream file(cache_path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::vector<std::string> parts;
+    std::istringstream stream(line);
+    std::string part;
+    while (std::getline(stream, part, '\t')) {
+      parts.push_back(part);
+    }
+    if (parts.size() != 6) {
+      continue;
+    }
+
+    try {
+      SplitPoints split_points;
+      split_points.path = parts[0];
+      split_points.mtime = std::stoll(parts[1]);
+      split_points.size = std::stoull(parts[2]);
+      split_points.split_size = std::stoull(parts[3]);
+      split_points.header_end = std::stoull(parts[4]);
+
+      std::istringstream offsets(parts[5]);
+      std::string offset;
+      while (std::getline(offsets, offset, ',')) {
+        split_points.offsets.push_back(std::stoull(offset));
+      }
+      entries[split_points.path] = split_points;
+    } catch (const std::exception&) {
+      // Ignore broken entries, they are computed again
+    }
+  }
+}
+
+void SplitPointCache::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache_path.empty() || !modified) {
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::path path(cache_path);
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), ec);
+  }
+
+  std::string tmp_path = cache_path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      return;
+    }
+    for (const auto& [source, split_points] : entries) {
+      file << split_points.path << "\t" << split_points.mtime << "\t" << split_points.size << "\t"
+           << split_points.split_size << "\t" << split_points.header_end << "\t";
+      for (size_t i = 0; i < split_points.offsets.size(); ++i) {
+        file << (i > 0 ? "," : "") << split_points.offsets[i];
+      }
+      file << "\n";
+    }
+  }
+  std::filesystem::rename(tmp_path, cache_path, ec);
+  modified = false;
+}
+
+bool SplitPointCache::get(const std::string& source, uint64_t split_size, SplitPoints& result) {
+  std::string extension = std::filesystem::path(source).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  if (extension != ".csv") {
+    return false;
+  }
+
+  std::error_code ec;
+  uint64_t size = std::filesystem::file_size(source, ec);
+  int64_t mtime = 0;
+  if (ec || !get_file_mtime(source, mtime)) {
+    return false;
+  }
+  std::string path = std::filesystem::absolute(source, ec).string();
+
+  std::string computation_key =
+      path + "\t" + std::to_string(mtime) + "\t" + std::to_string(size) + "\t" + std::to_string(split_size);
+  std::shared_ptr<Computation> computation;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) {
+      load();
+    }
+
+    auto it = entries.find(path);
+    if (it != entries.end() && it->second.mtime == mtime && it->second.size == size &&
+        it->second.split_size == split_size) {
+      result = it->second;
+      return true;
+    }
+
+    auto& slot = computations[computation_key];
+    if (!slot) {
+      slot = std::make_shared<Computation>();
+    }
+    computation = slot;
+  }
+
+  // Other threads needing the same source wait for the first computation,
+  // other sources are looked up and split meanwhile
+  std::call_once(computation->once, [&]() {
+    computation->split_points.path = path;
+    computation->split_points.mtime = mtime;
+    computation->computed = compute_split_points(path, split_size, computation->split_points);
+  });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  // Later lookups find the entry, or compute it again if it failed
+  computations.erase(computation_key);
+  if (!computation->computed) {
+    return false;
+  }
+
+  SplitPoints& entry = entries[path];
+  if (entry.mtime != mtime || entry.size != size || entry.split_size != split_size) {
+    entry = computation->split_points;
+    modified = true;
+  }
+  result = computation->split_points;
+  return true;
+}
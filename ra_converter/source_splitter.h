@@ -0,0 +1,55 @@
+#ifndef SOURCE_SPLITTER_H
+#define SOURCE_SPLITTER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SplitPoints {
+  std::string path;
+  int64_t mtime = 0;
+  uint64_t size = 0;
+  uint64_t split_size = 0;
+  uint64_t header_end = 0;       // first byte after the header record
+  std::vector<uint64_t> offsets;  // record aligned range boundaries, incl. header_end and size
+};
+
+// Computes and caches record aligned split points of CSV sources, so a source
+// can be scanned as several byte ranges in parallel. Quoted fields may contain
+// newlines, so a boundary is a newline preceded by an even number of quotes.
+// Entries are keyed by path, modification time, size and split size. Split
+// points are computed outside the cache lock, each version of a source once.
+class SplitPointCache {
+ private:
+  // Computation for one version of a source, shared by the threads that need it
+  struct Computation {
+    std::once_flag once;
+    SplitPoints split_points;
+    bool computed = false;
+  };
+
+  std::string cache_path;
+  std::unordered_map<std::string, SplitPoints> entries;
+  std::unordered_map<std::string, std::shared_ptr<Computation>> computations;  // by path, mtime, size, split size
+  std::mutex mutex;
+  bool loaded = false;
+  bool modified = false;
+
+  void load();
+
+ public:
+  void set_cache_path(const std::string& path);
+
+  // Returns false if the source is not a readable CSV file
+  bool get(const std::string& source, uint64_t split_size, SplitPoints& result);
+  void save();
+};
+
+// Computes the split points of a file by memory mapping it and scanning it
+// in parallel. Returns false if the file can not be mapped.
+bool compute_split_points(const std::string& path, uint64_t split_size, SplitPoints& result);
+
+#endif
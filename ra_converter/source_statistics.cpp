@@ -0,0 +1,490 @@
+#include "source_statistics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Sources up to this size are read completely, larger ones are sampled
+const uint64_t max_full_scan_bytes = 8 << 20;
+// Number and size of the chunks sampled from large sources
+const int sample_chunks = 16;
+const uint64_t sample_chunk_bytes = 256 << 10;
+// First line of the catalog file, catalogs of other versions are sampled again
+const std::string catalog_header = "statistics_catalog\t5";
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// HyperLogLog
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t hash_value(const std::string& value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+HyperLogLog::HyperLogLog()
+    : registers(1 << precision, 0) {}
+
+void HyperLogLog::add(const std::string& value) {
+  uint64_t hash = hash_value(value);
+  size_t index = hash >> (64 - precision);
+  uint64_t rest = hash << precision;
+  uint8_t rank = rest == 0 ? 64 - precision + 1 : __builtin_clzll(rest) + 1;
+  registers[index] = std::max(registers[index], rank);
+}
+
+double HyperLogLog::estimate() const {
+  const double m = registers.size();
+  const double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+  double sum = 0;
+  int zeros = 0;
+  for (uint8_t reg : registers) {
+    sum += std::ldexp(1.0, -reg);
+    if (reg == 0) {
+      zeros++;
+    }
+  }
+
+  double estimate = alpha * m * m / sum;
+  // Small range correction (linear counting)
+  if (estimate <= 2.5 * m && zeros > 0) {
+    estimate = m * std::log(m / zeros);
+  }
+  return estimate;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// CSV helpers
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::string utf8_bom = "\xEF\xBB\xBF";
+
+bool parse_csv_record(const std::string& data, size_t& pos, std::vector<std::string>& fields,
+                      char delimiter) {
+  fields.clear();
+  if (pos == 0 && data.starts_with(utf8_bom)) {
+    pos = utf8_bom.size();
+  }
+  if (pos >= data.size()) {
+    return false;
+  }
+
+  std::string field;
+  bool in_quotes = false;
+  while (pos < data.size()) {
+    char c = data[pos++];
+    if (in_quotes) {
+      if (c == '"') {
+        if (pos < data.size() && data[pos] == '"') {
+          field += '"';
+          pos++;
+        } else {
+          in_quotes = false;
+        }
+      } else {
+        field += c;
+      }
+    } else if (c == '"') {
+      in_quotes = true;
+    } else if (c == delimiter) {
+      fields.push_back(field);
+      field.clear();
+    } else if (c == '\n') {
+      break;
+    } else if (c != '\r') {
+      field += c;
+    }
+  }
+  fields.push_back(field);
+
+  return true;
+}
+
+char detect_csv_delimiter(const std::string& data) {
+  std::string seen;
+  bool in_quotes = false;
+  for (size_t pos = data.starts_with(utf8_bom) ? utf8_bom.size() : 0; pos < data.size(); ++pos) {
+    char c = data[pos];
+    if (c == '"') {
+      in_quotes = !in_quotes;
+    } else if (!in_quotes && c == '\n') {
+      break;
+    } else if (!in_quotes) {
+      seen += c;
+    }
+  }
+  for (char delimiter : {',', ';', '\t', '|'}) {
+    if (seen.find(delimiter) != std::string::npos) {
+      return delimiter;
+    }
+  }
+  return ',';
+}
+
+bool get_file_mtime(const std::string& path, int64_t& mtime) {
+  std::error_code ec;
+  auto time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+  mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+  return true;
+}
+
+// Returns true if the value only consists of IRI unreserved characters
+bool is_iri_safe(const std::string& value) {
+  for (unsigned char c : value) {
+    if (!std::isalnum(c) && c != '-' && c != '.' && c != '_' && c != '~') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses a complete field as decimal number with an optional exponent, i.e.
+// the lexical forms of xsd:decimal and xsd:double without INF and NaN. Unlike
+// strtod, surrounding spaces, hexadecimal and special values are rejected.
+bool parse_number(const std::string& value, double& number) {
+  size_t pos = 0;
+  if (pos < value.size() && (value[pos] == '+' || value[pos] == '-')) {
+    ++pos;
+  }
+  size_t digits = 0;
+  while (pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos]))) {
+    ++pos;
+    ++digits;
+  }
+  if (pos < value.size() && value[pos] == '.') {
+    ++pos;
+    while (pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos]))) {
+      ++pos;
+      ++digits;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (pos < value.size() && (value[pos] == 'e' || value[pos] == 'E')) {
+    ++pos;
+    if (pos < value.size() && (value[pos] == '+' || value[pos] == '-')) {
+      ++pos;
+    }
+    size_t exponent_digits = 0;
+    while (pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos]))) {
+      ++pos;
+      ++exponent_digits;
+    }
+    if (exponent_digits == 0) {
+      return false;
+    }
+  }
+  if (pos != value.size()) {
+    return false;
+  }
+
+  number = std::strtod(value.c_str(), nullptr);
+  return true;
+}
+
+std::string read_file_range(std::ifstream& file, uint64_t offset, uint64_t length) {
+  std::string buffer(length, '\0');
+  file.clear();
+  file.seekg(offset);
+  file.read(buffer.data(), length);
+  buffer.resize(file.gcount());
+  return buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Statistics catalog
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StatisticsCatalog::set_catalog_path(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (path != catalog_path) {
+    catalog_path = path;
+    entries.clear();
+    loaded = false;
+    modified = false;
+  }
+}
+
+// Format:
+//   statistics_catalog <tab> version
+//   S <tab> path <tab> mtime <tab> size <tab> rows <tab> complete <tab> number of columns
+//   C <tab> column <tab> distinct count <tab> null ratio <tab> sort order <tab> numeric <tab> iri safe
+void StatisticsCatalog::load() {
+  loaded = true;
+  if (catalog_path.empty()) {
+    return;
+  }
+
+  std::ifstream file(catalog_path);
+  std::string line;
+  if (!std::getline(file, line) || line != catalog_header) {
+    return;
+  }
+
+  SourceStatistics* current = nullptr;
+  while (std::getline(file, line)) {
+    std::vector<std::string> parts;
+    std::istringstream stream(line);
+    std::string part;
+    while (std::getline(stream, part, '\t')) {
+      parts.push_back(part);
+    }
+
+    try {
+      if (parts.size() == 7 && parts[0] == "S") {
+        SourceStatistics& stats = entries[parts[1]];
+        stats = SourceStatistics();
+        stats.path = parts[1];
+        stats.mtime = std::stoll(parts[2]);
+        stats.size = std::stoull(parts[3]);
+        stats.row_count = std::stod(parts[4]);
+        stats.complete = parts[5] == "1";
+        current = &stats;
+      } else if (parts.size() == 7 && parts[0] == "C" && current) {
+        current->columns[parts[1]] = {std::stod(parts[2]), std::stod(parts[3]), parts[4], parts[5] == "1",
+                                      parts[6] == "1"};
+      }
+    } catch (const std::exception&) {
+      // Ignore broken entries, they are sampled again
+      current = nullptr;
+    }
+  }
+}
+
+void StatisticsCatalog::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (catalog_path.empty() || !modified) {
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::path path(catalog_path);
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), ec);
+  }
+
+  // Write to a temporary file first, so a concurrent reader never sees a partial catalog
+  std::string tmp_path = catalog_path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      return;
+    }
+    file << catalog_header << "\n";
+    for (const auto& [source, stats] : entries) {
+      file << "S\t" << stats.path << "\t" << stats.mtime << "\t" << stats.size << "\t"
+           << stats.row_count << "\t" << stats.complete << "\t" << stats.columns.size() << "\n";
+      for (const auto& [column, column_stats] : stats.columns) {
+        file << "C\t" << column << "\t" << column_stats.distinct_count << "\t" << column_stats.null_ratio << "\t"
+             << column_stats.sort_order << "\t" << column_stats.numeric << "\t" << column_stats.iri_safe << "\n";
+      }
+    }
+  }
+  std::filesystem::rename(tmp_path, catalog_path, ec);
+  modified = false;
+}
+
+bool StatisticsCatalog::get(const std::string& source, SourceStatistics& result) {
+  std::string extension = std::filesystem::path(source).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  if (extension != ".csv") {
+    return false;
+  }
+
+  std::error_code ec;
+  uint64_t size = std::filesystem::file_size(source, ec);
+  int64_t mtime = 0;
+  if (ec || !get_file_mtime(source, mtime)) {
+    return false;
+  }
+
+  // Relative sources are keyed by their absolute path
+  std::string path = std::filesystem::absolute(source, ec).string();
+
+  std::string sample_key = path + "\t" + std::to_string(mtime) + "\t" + std::to_string(size);
+  std::shared_ptr<Sample> sample;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) {
+      load();
+    }
+
+    auto it = entries.find(path);
+    if (it != entries.end() && it->second.mtime == mtime && it->second.size == size) {
+      result = it->second;
+      return true;
+    }
+
+    auto& slot = samples[sample_key];
+    if (!slot) {
+      slot = std::make_shared<Sample>();
+    }
+    sample = slot;
+  }
+
+  // Other threads needing the same source wait for the first sample, other
+  // sources are looked up and sampled meanwhile
+  std::call_once(sample->once, [&]() { sample->stats = sample_source(path, mtime, size); });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  SourceStatistics& entry = entries[path];
+  if (entry.mtime != mtime || entry.size != size) {
+    entry = sample->stats;
+    modified = true;
+  }
+  // Later lookups find the entry
+  samples.erase(sample_key);
+  result = sample->stats;
+  return true;
+}
+
+SourceStatistics StatisticsCatalog::sample_source(const std::string& path, int64_t mtime, uint64_t size) {
+  SourceStatistics stats;
+  stats.path = path;
+  stats.mtime = mtime;
+  stats.size = size;
+
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file) {
+    return stats;
+  }
+
+  bool full_scan = size <= max_full_scan_bytes;
+  stats.complete = full_scan;
+
+  // Collect the sampled data, large files are sampled in evenly spread chunks
+  std::vector<std::string> chunks;
+  if (full_scan) {
+    chunks.push_back(read_file_range(file, 0, size));
+  } else {
+    for (int i = 0; i < sample_chunks; ++i) {
+      uint64_t offset = size / sample_chunks * i;
+      std::string chunk = read_file_range(file, offset, sample_chunk_bytes);
+      // Only keep complete lines
+      size_t begin = 0;
+      if (i > 0) {
+        begin = chunk.find('\n');
+        begin = begin == std::string::npos ? chunk.size() : begin + 1;
+      }
+      size_t end = chunk.rfind('\n');
+      end = end == std::string::npos || end < begin ? begin : end + 1;
+      chunks.push_back(chunk.substr(begin, end - begin));
+    }
+  }
+
+  // Parse header
+  std::vector<std::string> header;
+  size_t pos = 0;
+  char delimiter = detect_csv_delimiter(chunks[0]);
+  if (!parse_csv_record(chunks[0], pos, header, delimiter)) {
+    return stats;
+  }
+  uint64_t header_bytes = pos;
+
+  std::vector<HyperLogLog> sketches(header.size());
+  std::vector<uint64_t> null_counts(header.size(), 0);
+  uint64_t sampled_rows = 0;
+  uint64_t sampled_bytes = 0;
+
+  // Track whether the non-null values appear in ascending order. Only a full
+  // scan shows this, the rows between sampled chunks may be in any order.
+  std::vector<std::string> last_values(header.size());
+  std::vector<double> last_numbers(header.size(), 0);
+  std::vector<bool> lexical_sorted(header.size(), true);
+  std::vector<bool> numeric_sorted(header.size(), true);
+  std::vector<bool> numeric(header.size(), true);
+  std::vector<bool> iri_safe(header.size(), true);
+
+  std::vector<std::string> fields;
+  for (size_t c = 0; c < chunks.size(); ++c) {
+    size_t chunk_pos = c == 0 ? header_bytes : 0;
+    size_t start = chunk_pos;
+    while (parse_csv_record(chunks[c], chunk_pos, fields, delimiter)) {
+      if (fields.size() == 1 && fields[0].empty()) {
+        continue;  // skip empty lines
+      }
+      sampled_rows++;
+      for (size_t i = 0; i < header.size(); ++i) {
+        if (i >= fields.size() || fields[i].empty()) {
+          null_counts[i]++;
+          continue;
+        }
+        sketches[i].add(fields[i]);
+        if (iri_safe[i] && !is_iri_safe(fields[i])) {
+          iri_safe[i] = false;
+        }
+
+        double number = 0;
+        bool first_value = last_values[i].empty();
+        if (!first_value && fields[i] < last_values[i]) {
+          lexical_sorted[i] = false;
+        }
+        if (!parse_number(fields[i], number)) {
+          numeric[i] = false;
+          numeric_sorted[i] = false;
+        } else if (!first_value && number < last_numbers[i]) {
+          numeric_sorted[i] = false;
+        }
+        last_values[i] = fields[i];
+        last_numbers[i] = number;
+      }
+    }
+    sampled_bytes += chunk_pos - start;
+  }
+
+  if (full_scan || sampled_rows == 0) {
+    stats.row_count = sampled_rows;
+  } else {
+    double bytes_per_row = static_cast<double>(sampled_bytes) / sampled_rows;
+    stats.row_count = (size - header_bytes) / bytes_per_row;
+  }
+
+  for (size_t i = 0; i < header.size(); ++i) {
+    ColumnStatistics column_stats;
+    column_stats.null_ratio = sampled_rows == 0 ? 0 : static_cast<double>(null_counts[i]) / sampled_rows;
+
+    double distinct = std::min<double>(sketches[i].estimate(), sampled_rows - null_counts[i]);
+    double non_null_rows = stats.row_count * (1.0 - column_stats.null_ratio);
+    if (!full_scan && sampled_rows > null_counts[i]) {
+      // Nearly unique columns scale with the source, others are assumed to be complete
+      double sampled_non_null = sampled_rows - null_counts[i];
+      if (distinct >= 0.9 * sampled_non_null) {
+        distinct = distinct / sampled_non_null * non_null_rows;
+      }
+    }
+    column_stats.distinct_count = std::min(distinct, non_null_rows);
+
+    // The sort order and the facts only hold if every row was read
+    if (full_scan && sampled_rows > null_counts[i]) {
+      column_stats.numeric = numeric[i];
+      column_stats.iri_safe = iri_safe[i];
+      if (numeric_sorted[i]) {
+        column_stats.sort_order = "numeric";
+      } else if (lexical_sorted[i]) {
+        column_stats.sort_order = "lexical";
+      }
+    }
+
+    stats.columns[header[i]] = column_stats;
+  }
+
+  return stats;
+}
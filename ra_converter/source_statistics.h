@@ -0,0 +1,88 @@
+#ifndef SOURCE_STATISTICS_H
+#define SOURCE_STATISTICS_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sketch to estimate the number of distinct values of a column
+class HyperLogLog {
+ private:
+  static const int precision = 12;
+  std::vector<uint8_t> registers;
+
+ public:
+  HyperLogLog();
+
+  void add(const std::string& value);
+  double estimate() const;
+};
+
+struct ColumnStatistics {
+  double distinct_count = 0;
+  double null_ratio = 0;
+  // Only set from complete scans, a sample can miss the row that breaks them
+  std::string sort_order = "none";  // none, numeric or lexical (ascending)
+  bool numeric = false;              // all non-null values are decimal numbers
+  bool iri_safe = false;             // no value needs percent-encoding in an IRI
+};
+
+struct SourceStatistics {
+  std::string path;
+  int64_t mtime = 0;
+  uint64_t size = 0;
+  double row_count = 0;
+  bool complete = false;  // all rows were read, not only a sample
+  std::unordered_map<std::string, ColumnStatistics> columns;
+};
+
+// Catalog of sampled statistics of CSV sources.
+// Entries are keyed by path, modification time and size, so a changed source
+// is sampled again. The catalog is persisted in a tab separated text file.
+// Sources are sampled outside the catalog lock, each version of a source once.
+class StatisticsCatalog {
+ private:
+  // Sampling of one version of a source, shared by the threads that need it
+  struct Sample {
+    std::once_flag once;
+    SourceStatistics stats;
+  };
+
+  std::string catalog_path;
+  std::unordered_map<std::string, SourceStatistics> entries;
+  std::unordered_map<std::string, std::shared_ptr<Sample>> samples;  // by path, mtime and size
+  std::mutex mutex;
+  bool loaded = false;
+  bool modified = false;
+
+  void load();
+  SourceStatistics sample_source(const std::string& path, int64_t mtime, uint64_t size);
+
+ public:
+  void set_catalog_path(const std::string& path);
+
+  // Returns false if the source is not a readable CSV file
+  bool get(const std::string& source, SourceStatistics& result);
+  void save();
+};
+
+// Splits the next CSV record starting at pos, handling quoted fields. A UTF-8
+// byte order mark at the start of the data is skipped. Returns false if no
+// record is left.
+bool parse_csv_record(const std::string& data, size_t& pos, std::vector<std::string>& fields,
+                      char delimiter = ',');
+
+// Guesses the delimiter from the header record: a comma if the header has one,
+// else the first of semicolon, tab or bar that it has, else a comma.
+char detect_csv_delimiter(const std::string& data);
+
+// 64 bit hash of a string, FNV-1a followed by the splitmix64 finalizer
+uint64_t hash_value(const std::string& value);
+
+// Gets the modification time of a file, returns false if it does not exist
+bool get_file_mtime(const std::string& path, int64_t& mtime);
+
+#endif
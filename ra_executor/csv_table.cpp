@@ -0,0 +1,88 @@
+#include "csv_table.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "../ra_converter/source_statistics.h"
+
+namespace ra_executor {
+
+int64_t CsvTable::find_row(uint64_t offset) const {
+  auto it = std::lower_bound(offsets.begin(), offsets.end(), offset);
+  if (it == offsets.end() || *it != offset) {
+    return -1;
+  }
+  return it - offsets.begin();
+}
+
+CsvTable read_csv_table(const std::string& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open source: " + path);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string data = buffer.str();
+
+  CsvTable table;
+  size_t pos = 0;
+  char delimiter = detect_csv_delimiter(data);
+  if (!parse_csv_record(data, pos, table.header, delimiter)) {
+    throw std::runtime_error("Source '" + path + "' has no header.");
+  }
+
+  // The columns are shared once they are complete
+  std::vector<std::vector<std::string>> columns(table.header.size());
+  std::vector<std::string> row_ids;
+  std::vector<std::string> fields;
+  while (true) {
+    size_t offset = pos;
+    if (!parse_csv_record(data, pos, fields, delimiter)) {
+      break;
+    }
+    if (fields.size() == 1 && fields[0].empty()) {
+      continue;  // skip empty lines
+    }
+    fields.resize(table.header.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+      columns[i].push_back(std::move(fields[i]));
+    }
+    table.offsets.push_back(offset);
+    row_ids.push_back(std::to_string(offset));
+  }
+
+  for (auto& column : columns) {
+    table.columns.push_back(std::make_shared<const std::vector<std::string>>(std::move(column)));
+  }
+  table.row_ids = std::make_shared<const std::vector<std::string>>(std::move(row_ids));
+  return table;
+}
+
+std::shared_ptr<const CsvTable> SourceCache::get(const std::string& path) {
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = entries[path];
+    if (!slot) {
+      slot = std::make_shared<Entry>();
+    }
+    entry = slot;
+  }
+
+  // Other plans reading the same source wait for the first read
+  std::call_once(entry->once, [&]() {
+    try {
+      entry->table = std::make_shared<const CsvTable>(read_csv_table(path));
+    } catch (...) {
+      entry->error = std::current_exception();
+    }
+  });
+  if (entry->error) {
+    std::rethrow_exception(entry->error);
+  }
+  return entry->table;
+}
+
+}  // namespace ra_executor
@@ -0,0 +1,55 @@
+#ifndef CSV_TABLE_H
+#define CSV_TABLE_H
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ra_executor {
+
+using Column = std::shared_ptr<const std::vector<std::string>>;
+
+// A CSV source stored column by column. A record is identified by its byte
+// offset in the file, which is its row ID and does not depend on the range
+// it was scanned in.
+struct CsvTable {
+  std::vector<std::string> header;
+  std::vector<Column> columns;   // one column per header attribute
+  Column row_ids;                // the offsets as text, the #rowid attribute
+  std::vector<uint64_t> offsets;  // ascending
+
+  size_t rows() const { return offsets.size(); }
+
+  // Returns the row of the record starting at the offset, or -1
+  int64_t find_row(uint64_t offset) const;
+};
+
+// Reads a CSV file with a header record. Records with fewer fields than the
+// header are padded with empty values. Throws std::runtime_error if the file
+// can not be read.
+CsvTable read_csv_table(const std::string& path);
+
+// Reads every source once for all plans of an execution, also when the
+// plans are executed in parallel
+class SourceCache {
+ private:
+  struct Entry {
+    std::once_flag once;
+    std::shared_ptr<const CsvTable> table;
+    std::exception_ptr error;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+
+ public:
+  std::shared_ptr<const CsvTable> get(const std::string& path);
+};
+
+}  // namespace ra_executor
+
+#endif
@@ -0,0 +1,624 @@
+#include "plan_parser.h"
+
+#include <set>
+#include <stdexcept>
+
+namespace ra_executor {
+
+const std::string row_id_attribute = "#rowid";
+
+int PlanSchema::find(const std::string& name) const {
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i].name() == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Parsing
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::set<std::string> term_map_types = {"constant", "template", "reference"};
+const std::set<std::string> term_types = {"iri", "blanknode", "literal"};
+
+// Recursive descent parser over one plan line
+class PlanParser {
+ private:
+  const std::string& text;
+  size_t pos = 0;
+
+  [[noreturn]] void fail(const std::string& message) const {
+    throw std::runtime_error("Invalid plan: " + message + " at offset " + std::to_string(pos) + ".");
+  }
+
+  bool starts_with(const std::string& token) const { return text.compare(pos, token.size(), token) == 0; }
+
+  void expect(const std::string& token) {
+    if (!starts_with(token)) {
+      fail("expected '" + token + "'");
+    }
+    pos += token.size();
+  }
+
+  void skip_spaces() {
+    while (pos < text.size() && text[pos] == ' ') {
+      pos++;
+    }
+  }
+
+  // Reads up to the first of the stop characters, which is not consumed
+  std::string read_until(const std::string& stop) {
+    size_t end = text.find_first_of(stop, pos);
+    if (end == std::string::npos) {
+      fail("expected one of '" + stop + "'");
+    }
+    std::string result = text.substr(pos, end - pos);
+    pos = end;
+    return result;
+  }
+
+  // Parses the items up to the terminator, an empty list has no items
+  std::vector<std::string> parse_list(char separator, char terminator) {
+    std::vector<std::string> items;
+    std::string stop = {separator, terminator};
+    if (pos < text.size() && text[pos] == terminator) {
+      pos++;
+      return items;
+    }
+    while (true) {
+      items.push_back(read_until(stop));
+      if (text[pos++] == terminator) {
+        return items;
+      }
+    }
+  }
+
+  void parse_annotations(std::map<std::string, std::string>& annotations) {
+    while (starts_with("@[")) {
+      pos += 2;
+      for (const auto& item : parse_list(',', ']')) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+          fail("expected 'key=value' annotation");
+        }
+        annotations[item.substr(0, equals)] = item.substr(equals + 1);
+      }
+    }
+  }
+
+  // Parses create(...) -> X. Term maps may contain commas and parentheses, so
+  // the arguments end at the first ") -> X" followed by a separator, and the
+  // fixed arguments are taken from the right.
+  CreateTerm parse_create_term() {
+    expect("create(");
+    size_t end = pos;
+    while (true) {
+      end = text.find(") -> ", end);
+      if (end == std::string::npos || end + 6 > text.size()) {
+        fail("unterminated create term");
+      }
+      char position = text[end + 5];
+      char next = end + 6 < text.size() ? text[end + 6] : '\0';
+      if (std::string("SPOG").find(position) != std::string::npos && (next == ',' || next == ';' || next == ']')) {
+        break;
+      }
+      end++;
+    }
+
+    std::vector<std::string> parts;
+    size_t start = pos;
+    for (size_t comma = text.find(',', start); comma < end; comma = text.find(',', start)) {
+      parts.push_back(text.substr(start, comma - start));
+      start = comma + 1;
+    }
+    parts.push_back(text.substr(start, end - start));
+
+    CreateTerm term;
+    size_t n = parts.size();
+    size_t fixed = 0;
+    if (n >= 5 && term_map_types.contains(parts[n - 4]) && term_types.contains(parts[n - 3])) {
+      fixed = 4;
+      term.lang_tag = parts[n - 2];
+      term.data_type = parts[n - 1];
+    } else if (n >= 3 && term_map_types.contains(parts[n - 2]) && term_types.contains(parts[n - 1])) {
+      fixed = 2;
+    } else {
+      fail("invalid arguments of create term");
+    }
+    term.term_map_type = parts[n - fixed];
+    term.term_type = parts[n - fixed + 1];
+    for (size_t i = 0; i < n - fixed; ++i) {
+      term.term_map += (i > 0 ? "," : "") + parts[i];
+    }
+
+    term.position = text[end + 5];
+    pos = end + 6;
+    return term;
+  }
+
+  // Parses the null filter that may precede a fork head
+  std::vector<std::string> parse_head_filter() {
+    if (!starts_with("sigma[not null(")) {
+      return {};
+    }
+    pos += 15;
+    std::vector<std::string> attributes = parse_list(',', ')');
+    expect("] ");
+    return attributes;
+  }
+
+  // Parses the create terms up to ']', several heads are separated by ';'
+  // and may start with a null filter
+  std::vector<std::vector<CreateTerm>> parse_heads(bool allow_several,
+                                                   std::vector<std::vector<std::string>>* filters = nullptr) {
+    std::vector<std::vector<CreateTerm>> heads(1);
+    if (allow_several) {
+      filters->push_back(parse_head_filter());
+    }
+    while (true) {
+      heads.back().push_back(parse_create_term());
+      char c = pos < text.size() ? text[pos++] : '\0';
+      if (c == ']') {
+        return heads;
+      }
+      if (c == ';' && allow_several) {
+        heads.emplace_back();
+        filters->push_back(parse_head_filter());
+      } else if (c != ',') {
+        pos--;
+        fail("expected ',' or ']'");
+      }
+    }
+  }
+
+  std::vector<std::array<std::string, 2>> parse_conditions() {
+    expect("[");
+    std::vector<std::array<std::string, 2>> conditions;
+    for (const auto& item : parse_list(',', ']')) {
+      size_t equals = item.find('=');
+      if (equals == std::string::npos) {
+        fail("expected 'left=right' join condition");
+      }
+      conditions.push_back({item.substr(0, equals), item.substr(equals + 1)});
+    }
+    return conditions;
+  }
+
+  PlanNode parse_child() {
+    expect("(");
+    PlanNode child = parse_expression();
+    expect(")");
+    return child;
+  }
+
+  // A source ends before ')', an annotation or a binary operator
+  std::string parse_source_name() {
+    size_t end = pos;
+    while (end < text.size() && text[end] != ')' && text.compare(end, 2, "@[") != 0 &&
+           text.compare(end, 6, " cup (") != 0 && text.compare(end, 8, " bowtie ") != 0 &&
+           text.compare(end, 8, " ltimes ") != 0) {
+      end++;
+    }
+    if (end == pos) {
+      fail("expected a source");
+    }
+    std::string source = text.substr(pos, end - pos);
+    pos = end;
+    return source;
+  }
+
+  uint64_t parse_offset(const std::string& value) {
+    try {
+      size_t length = 0;
+      uint64_t offset = std::stoull(value, &length);
+      if (length == value.size()) {
+        return offset;
+      }
+    } catch (const std::exception&) {
+    }
+    fail("invalid offset '" + value + "'");
+  }
+
+  PlanNode parse_primary() {
+    PlanNode node;
+    if (starts_with("(")) {
+      node = parse_child();
+    } else if (starts_with("pi[create(")) {
+      pos += 3;
+      node.op = PlanOperator::Create;
+      node.heads = parse_heads(false);
+      node.children.push_back(parse_child());
+    } else if (starts_with("pi[")) {
+      pos += 3;
+      node.op = PlanOperator::Projection;
+      node.attributes = parse_list(',', ']');
+      node.children.push_back(parse_child());
+    } else if (starts_with("sigma[not null(")) {
+      pos += 15;
+      node.op = PlanOperator::Selection;
+      node.attributes = parse_list(',', ')');
+      expect("]");
+      node.children.push_back(parse_child());
+    } else if (starts_with("delta(")) {
+      pos += 5;
+      node.op = PlanOperator::Distinct;
+      node.children.push_back(parse_child());
+    } else if (starts_with("limit[")) {
+      pos += 6;
+      node.op = PlanOperator::Limit;
+      node.limit = parse_offset(read_until("]"));
+      pos++;
+      node.children.push_back(parse_child());
+    } else if (starts_with("bind[")) {
+      pos += 5;
+      node.op = PlanOperator::Bind;
+      node.heads = parse_heads(false);
+      node.children.push_back(parse_child());
+    } else if (starts_with("const[")) {
+      pos += 6;
+      node.op = PlanOperator::Constant;
+      node.heads = parse_heads(false);
+    } else if (starts_with("fork[")) {
+      pos += 5;
+      node.op = PlanOperator::Fork;
+      node.heads = parse_heads(true, &node.head_filters);
+      node.children.push_back(parse_child());
+    } else if (starts_with("fetch[")) {
+      pos += 6;
+      node.op = PlanOperator::Fetch;
+      node.source = read_until(":");
+      pos++;
+      node.attributes = parse_list(',', ']');
+      node.children.push_back(parse_child());
+    } else if (starts_with("range[")) {
+      pos += 6;
+      node.op = PlanOperator::Range;
+      std::vector<std::string> offsets = parse_list(',', ']');
+      if (offsets.size() != 2) {
+        fail("expected 'begin,end' range");
+      }
+      node.begin = parse_offset(offsets[0]);
+      node.end = parse_offset(offsets[1]);
+      expect("(");
+      node.source = parse_source_name();
+      expect(")");
+    } else {
+      node.op = PlanOperator::Source;
+      node.source = parse_source_name();
+    }
+
+    parse_annotations(node.annotations);
+    return node;
+  }
+
+ public:
+  explicit PlanParser(const std::string& text) : text(text) {}
+
+  // Binary operators are left associative, their operands are parenthesized
+  PlanNode parse_expression() {
+    PlanNode node = parse_primary();
+    while (true) {
+      size_t operator_pos = pos;
+      skip_spaces();
+
+      PlanNode binary;
+      if (starts_with("cup ")) {
+        pos += 4;
+        binary.op = PlanOperator::Union;
+      } else if (starts_with("bowtie ")) {
+        pos += 7;
+        binary.op = PlanOperator::Join;
+        if (starts_with("[")) {
+          binary.conditions = parse_conditions();
+        }
+      } else if (starts_with("ltimes ")) {
+        pos += 7;
+        binary.op = PlanOperator::SemiJoin;
+        binary.conditions = parse_conditions();
+      } else {
+        pos = operator_pos;
+        return node;
+      }
+      parse_annotations(binary.annotations);
+      skip_spaces();
+
+      binary.children.push_back(std::move(node));
+      binary.children.push_back(parse_primary());
+      node = std::move(binary);
+    }
+  }
+
+  PlanNode parse() {
+    PlanNode plan = parse_expression();
+    if (pos != text.size()) {
+      fail("unexpected '" + text.substr(pos, 16) + "'");
+    }
+    return plan;
+  }
+};
+
+PlanNode parse_plan(const std::string& plan) {
+  return PlanParser(plan).parse();
+}
+
+std::vector<std::string> template_attributes(const std::string& term_map) {
+  // Same as the converter, an escaped brace does not start an attribute
+  std::vector<std::string> attributes;
+  size_t start = 0;
+  while ((start = term_map.find('{', start)) != std::string::npos) {
+    if (start > 0 && term_map[start - 1] == '\\') {
+      start++;
+      continue;
+    }
+    size_t end = term_map.find('}', start);
+    if (end == std::string::npos) {
+      break;
+    }
+    attributes.push_back(term_map.substr(start + 1, end - start - 1));
+    start = end + 1;
+  }
+  return attributes;
+}
+
+std::vector<std::string> term_attributes(const CreateTerm& term) {
+  if (term.term_map_type == "template") {
+    return template_attributes(term.term_map);
+  }
+  if (term.term_map_type == "reference") {
+    return {term.term_map};
+  }
+  return {};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Validation
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* operator_name(PlanOperator op) {
+  switch (op) {
+    case PlanOperator::Source: return "source";
+    case PlanOperator::Range: return "range";
+    case PlanOperator::Projection: return "pi";
+    case PlanOperator::Selection: return "sigma";
+    case PlanOperator::Distinct: return "delta";
+    case PlanOperator::Limit: return "limit";
+    case PlanOperator::Union: return "cup";
+    case PlanOperator::Join: return "bowtie";
+    case PlanOperator::SemiJoin: return "ltimes";
+    case PlanOperator::Fetch: return "fetch";
+    case PlanOperator::Create: return "pi";
+    case PlanOperator::Bind: return "bind";
+    case PlanOperator::Constant: return "const";
+    case PlanOperator::Fork: return "fork";
+  }
+  return "";
+}
+
+// The source a relation was read from, the left one of a union
+const std::string& base_source(const PlanNode& node) {
+  if (node.op == PlanOperator::Source || node.op == PlanOperator::Range) {
+    return node.source;
+  }
+  if (node.children.empty()) {
+    throw std::runtime_error("Invalid plan: '" + std::string(operator_name(node.op)) + "' has no input.");
+  }
+  return base_source(node.children[0]);
+}
+
+void check_attribute(const PlanSchema& schema, const std::string& name, PlanOperator op) {
+  if (schema.open || schema.find(name) >= 0) {
+    return;
+  }
+  throw std::runtime_error("Invalid plan: '" + std::string(operator_name(op)) + "' references the unknown attribute '" +
+                           name + "'.");
+}
+
+PlanSchema source_columns(const std::string& source, const SourceSchema& source_schema) {
+  PlanSchema schema;
+  std::vector<std::string> attributes;
+  if (source_schema) {
+    attributes = source_schema(source);
+  }
+  schema.open = attributes.empty();
+  for (const auto& attribute : attributes) {
+    schema.columns.push_back({source, attribute, false});
+  }
+  schema.columns.push_back({source, row_id_attribute, false});
+  return schema;
+}
+
+PlanSchema plan_schema(const PlanNode& node, const SourceSchema& source_schema) {
+  switch (node.op) {
+    case PlanOperator::Source:
+    case PlanOperator::Range: {
+      if (node.op == PlanOperator::Range && node.begin >= node.end) {
+        throw std::runtime_error("Invalid plan: empty range of '" + node.source + "'.");
+      }
+      return source_columns(node.source, source_schema);
+    }
+
+    case PlanOperator::Projection: {
+      PlanSchema input = plan_schema(node.children[0], source_schema);
+      PlanSchema schema;
+      for (const auto& attribute : node.attributes) {
+        check_attribute(input, attribute, node.op);
+        int index = input.find(attribute);
+        schema.columns.push_back(index >= 0 ? input.columns[index]
+                                            : PlanColumn{base_source(node.children[0]), attribute, false});
+      }
+      return schema;
+    }
+
+    case PlanOperator::Selection: {
+      PlanSchema input = plan_schema(node.children[0], source_schema);
+      for (const auto& attribute : node.attributes) {
+        check_attribute(input, attribute, node.op);
+      }
+      return input;
+    }
+
+    case PlanOperator::Distinct:
+    case PlanOperator::Limit:
+      return plan_schema(node.children[0], source_schema);
+
+    case PlanOperator::Union: {
+      PlanSchema left = plan_schema(node.children[0], source_schema);
+      PlanSchema right = plan_schema(node.children[1], source_schema);
+      if (left.open || right.open) {
+        left.open = true;
+        return left;
+      }
+
+      // The sources of a plan template may have different headers, the
+      // projection above the union only reads the attributes they share
+      PlanSchema shared;
+      for (const auto& column : left.columns) {
+        if (right.find(column.name()) >= 0) {
+          shared.columns.push_back(column);
+        }
+      }
+      return shared;
+    }
+
+    case PlanOperator::Join:
+    case PlanOperator::SemiJoin: {
+      PlanSchema left = plan_schema(node.children[0], source_schema);
+      PlanSchema right = plan_schema(node.children[1], source_schema);
+      if (node.op == PlanOperator::Join && node.conditions.empty()) {
+        // A natural join keeps the attribute names
+        for (const auto& column : right.columns) {
+          if (left.find(column.name()) < 0) {
+            left.columns.push_back(column);
+          }
+        }
+        left.open = left.open || right.open;
+        return left;
+      }
+
+      // The conditions reference the attributes qualified with their source
+      PlanSchema qualified_left = left;
+      PlanSchema qualified_right = right;
+      for (auto& column : qualified_left.columns) {
+        column.qualified = true;
+      }
+      for (auto& column : qualified_right.columns) {
+        column.qualified = true;
+      }
+      for (const auto& condition : node.conditions) {
+        check_attribute(qualified_left, condition[0], node.op);
+        check_attribute(qualified_right, condition[1], node.op);
+      }
+      if (node.op == PlanOperator::SemiJoin) {
+        return left;
+      }
+
+      qualified_left.columns.insert(qualified_left.columns.end(), qualified_right.columns.begin(),
+                                    qualified_right.columns.end());
+      qualified_left.open = left.open || right.open;
+      return qualified_left;
+    }
+
+    case PlanOperator::Fetch: {
+      PlanSchema schema = plan_schema(node.children[0], source_schema);
+      check_attribute(schema, node.source + "_" + row_id_attribute, node.op);
+      for (const auto& attribute : node.attributes) {
+        schema.columns.push_back({node.source, attribute, true});
+      }
+      return schema;
+    }
+
+    default:
+      throw std::runtime_error("Invalid plan: '" + std::string(operator_name(node.op)) +
+                               "' creates terms, but its parent expects a relation.");
+  }
+}
+
+void validate_terms(const std::vector<CreateTerm>& terms, const PlanSchema& schema, PlanOperator op) {
+  std::map<char, size_t> positions;
+  for (const auto& term : terms) {
+    positions[term.position]++;
+
+    if (term.term_map.empty()) {
+      throw std::runtime_error("Invalid plan: empty term map in '" + std::string(operator_name(op)) + "'.");
+    }
+    if (term.term_type == "literal" && term.position != 'O') {
+      throw std::runtime_error("Invalid plan: literal " + std::string(1, term.position) + " term '" +
+                               term.term_map + "'.");
+    }
+    if (term.term_type == "blanknode" && term.position == 'P') {
+      throw std::runtime_error("Invalid plan: blank node P term '" + term.term_map + "'.");
+    }
+    if ((term.lang_tag != "None" || term.data_type != "None") && term.term_type != "literal") {
+      throw std::runtime_error("Invalid plan: language or datatype of the non-literal term '" + term.term_map + "'.");
+    }
+    for (const auto& attribute : term_attributes(term)) {
+      check_attribute(schema, attribute, op);
+    }
+  }
+
+  for (char position : std::string("SPO")) {
+    if (positions[position] != 1) {
+      throw std::runtime_error("Invalid plan: " + std::to_string(positions[position]) + " " +
+                               std::string(1, position) + " terms, expected one.");
+    }
+  }
+  if (positions['G'] > 1) {
+    throw std::runtime_error("Invalid plan: " + std::to_string(positions['G']) + " G terms, expected at most one.");
+  }
+}
+
+void validate_plan(const PlanNode& plan, const SourceSchema& source_schema) {
+  switch (plan.op) {
+    case PlanOperator::Constant:
+      validate_terms(plan.heads[0], PlanSchema(), plan.op);
+      return;
+
+    case PlanOperator::Create:
+      validate_terms(plan.heads[0], plan_schema(plan.children[0], source_schema), plan.op);
+      return;
+
+    case PlanOperator::Bind: {
+      // The constants are bound to the rows of a create or of a relation
+      std::vector<CreateTerm> terms = plan.heads[0];
+      const PlanNode* input = &plan.children[0];
+      if (input->op == PlanOperator::Create) {
+        terms.insert(terms.end(), input->heads[0].begin(), input->heads[0].end());
+        input = &input->children[0];
+      }
+      for (const auto& term : plan.heads[0]) {
+        if (term.term_map_type != "constant") {
+          throw std::runtime_error("Invalid plan: 'bind' of the non-constant term '" + term.term_map + "'.");
+        }
+      }
+      validate_terms(terms, plan_schema(*input, source_schema), plan.op);
+      return;
+    }
+
+    case PlanOperator::Fork: {
+      PlanSchema schema = plan_schema(plan.children[0], source_schema);
+      for (size_t i = 0; i < plan.heads.size(); ++i) {
+        for (const auto& attribute : plan.head_filters[i]) {
+          check_attribute(schema, attribute, plan.op);
+        }
+        validate_terms(plan.heads[i], schema, plan.op);
+      }
+      return;
+    }
+
+    default:
+      throw std::runtime_error("Invalid plan: the root '" + std::string(operator_name(plan.op)) +
+                               "' creates no terms.");
+  }
+}
+
+size_t count_operators(const PlanNode& plan) {
+  size_t count = 1;
+  for (const auto& child : plan.children) {
+    count += count_operators(child);
+  }
+  return count;
+}
+
+}  // namespace ra_executor
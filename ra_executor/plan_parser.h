@@ -0,0 +1,124 @@
+#ifndef PLAN_PARSER_H
+#define PLAN_PARSER_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ra_executor {
+
+// Operators of the plans emitted by the converter, one plan per line:
+//   source.csv                          scan of a source
+//   range[begin,end](source.csv)        scan of a record aligned byte range
+//   pi[a,b](input)                      projection on attributes
+//   sigma[not null(a,b)](input)         drops rows with a null or empty attribute
+//   delta(input)                        duplicate elimination
+//   limit[n](input)                     the first n rows of the input
+//   (left) cup (right)                  union of sources with the same schema
+//   (left) bowtie [l=r,...] (right)     equi-join, a natural join without condition
+//   (left) ltimes [l=r,...] (right)     semi-join, keeps the left rows with a match
+//   fetch[source:a,b](input)            reads attributes of the rows with the joined row IDs
+//   pi[create(...) -> S,...](input)     creates the terms of every input row
+//   bind[create(...) -> P,...](input)   adds constant terms to every input row
+//   const[create(...) -> S,...]         a single row of constant terms
+//   fork[terms;terms;...](input)        several create lists on the same input, a
+//                                       list may start with "sigma[not null(a,b)] "
+//                                       to only create terms for the rows it keeps
+// Every node may be followed by annotations, e.g. "@[rows=100,cost=5]".
+enum class PlanOperator {
+  Source,
+  Range,
+  Projection,
+  Selection,
+  Distinct,
+  Limit,
+  Union,
+  Join,
+  SemiJoin,
+  Fetch,
+  Create,
+  Bind,
+  Constant,
+  Fork
+};
+
+// create(term_map,term_map_type,term_type[,lang_tag,data_type]) -> position
+struct CreateTerm {
+  std::string term_map;
+  std::string term_map_type;  // constant, template, reference
+  std::string term_type;      // iri, blanknode, literal
+  std::string lang_tag = "None";
+  std::string data_type = "None";
+  char position = 'S';  // S, P, O or G
+};
+
+struct PlanNode {
+  PlanOperator op = PlanOperator::Source;
+  std::string source;                                    // Source, Range, Fetch
+  uint64_t begin = 0;                                    // Range
+  uint64_t end = 0;                                      // Range
+  uint64_t limit = 0;                                    // Limit
+  std::vector<std::string> attributes;                   // Projection, Selection, Fetch
+  std::vector<std::array<std::string, 2>> conditions;    // Join, SemiJoin: left and right attribute
+  std::vector<std::vector<CreateTerm>> heads;            // Create, Bind, Constant: one list, Fork: one per head
+  std::vector<std::vector<std::string>> head_filters;    // Fork: the null filtered attributes of every head
+  std::map<std::string, std::string> annotations;
+  std::vector<PlanNode> children;
+};
+
+// An attribute of an intermediate relation. Above a join, attributes are
+// referenced as "<source>_<attribute>", qualified with the source they were
+// read from.
+struct PlanColumn {
+  std::string source;
+  std::string attribute;
+  bool qualified = false;
+
+  std::string name() const { return qualified ? source + "_" + attribute : attribute; }
+};
+
+// The columns of a relational node. The attributes of a source without a
+// known schema are not listed, the schema is open and accepts any attribute.
+struct PlanSchema {
+  std::vector<PlanColumn> columns;
+  bool open = false;
+
+  // Returns the index of the column with the name, or -1
+  int find(const std::string& name) const;
+};
+
+// The row ID attribute of a source, as projected by late materialization
+extern const std::string row_id_attribute;
+
+// Parses one plan line. Throws std::runtime_error with the offset of the
+// error if the plan is malformed.
+PlanNode parse_plan(const std::string& plan);
+
+// Returns the names of the attributes of a template, e.g. {a} and {b}
+std::vector<std::string> template_attributes(const std::string& term_map);
+
+// Returns the attributes a term reads from its input
+std::vector<std::string> term_attributes(const CreateTerm& term);
+
+// Returns the attributes of a source, or an empty list if they are unknown
+using SourceSchema = std::function<std::vector<std::string>(const std::string& source)>;
+
+// Returns the columns of a relational node and checks that its operators only
+// reference attributes of their inputs. Throws std::runtime_error otherwise.
+PlanSchema plan_schema(const PlanNode& node, const SourceSchema& source_schema);
+
+// Checks that a parsed plan creates exactly one subject, predicate and object,
+// at most one graph, with valid term types, and that every referenced
+// attribute is produced by the input of its operator. Throws
+// std::runtime_error on the first violation.
+void validate_plan(const PlanNode& plan, const SourceSchema& source_schema = nullptr);
+
+// Returns the number of operators of a plan
+size_t count_operators(const PlanNode& plan);
+
+}  // namespace ra_executor
+
+#endif
@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "ra_executor.h"
+
+void print_usage() {
+  std::cerr << "Usage: ra_execute [-t threads] [-b base_uri] [-o output_file] [--continue-on-error] [--profile] [plan_file]"
+            << std::endl
+            << std::endl
+            << "Executes relational algebra plans, one per line, over their CSV sources and" << std::endl
+            << "writes the created quads as N-Quads. The plans are read from stdin without" << std::endl
+            << "a plan file and the quads are written to stdout without an output file." << std::endl
+            << "With --profile the seconds and quads of every plan are printed to stderr." << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::string plan_path;
+  std::string output_path;
+  bool profile = false;
+  ra_executor::ExecutorOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    if ((std::strcmp(argv[i], "-t") == 0 || std::strcmp(argv[i], "--threads") == 0) && i + 1 < argc) {
+      options.num_threads = std::stoul(argv[++i]);
+    } else if ((std::strcmp(argv[i], "-b") == 0 || std::strcmp(argv[i], "--base-uri") == 0) && i + 1 < argc) {
+      options.base_uri = argv[++i];
+    } else if ((std::strcmp(argv[i], "-o") == 0 || std::strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--continue-on-error") == 0) {
+      options.continue_on_error = true;
+    } else if (std::strcmp(argv[i], "--profile") == 0) {
+      profile = true;
+    } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+      print_usage();
+      return 0;
+    } else if (plan_path.empty() && argv[i][0] != '-') {
+      plan_path = argv[i];
+    } else {
+      print_usage();
+      return 2;
+    }
+  }
+
+  std::ifstream plan_file;
+  if (!plan_path.empty()) {
+    plan_file.open(plan_path);
+    if (!plan_file) {
+      std::cerr << "Error: Could not open file: " << plan_path << std::endl;
+      return 1;
+    }
+  }
+  std::istream& in = plan_path.empty() ? std::cin : plan_file;
+
+  std::vector<std::string> plans;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      plans.push_back(line);
+    }
+  }
+
+  std::vector<ra_executor::PlanOutput> outputs;
+  try {
+    ra_executor::SourceCache sources;
+    outputs = ra_executor::execute_plans(plans, sources, options);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream output_file;
+  if (!output_path.empty()) {
+    output_file.open(output_path, std::ios::trunc);
+  }
+  std::ostream& out = output_path.empty() ? std::cout : output_file;
+  size_t quads = ra_executor::write_nquads(outputs, out);
+  if (!out) {
+    std::cerr << "Error: Could not write file: " << output_path << std::endl;
+    return 1;
+  }
+
+  int failed = 0;
+  double seconds = 0;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (!outputs[i].error.empty()) {
+      std::cerr << "Error: " << outputs[i].error << std::endl;
+      ++failed;
+    }
+    if (profile) {
+      std::fprintf(stderr, "Plan %zu: %.3f s, %zu quads\n", i + 1, outputs[i].seconds, outputs[i].quads.size());
+    }
+    seconds += outputs[i].seconds;
+  }
+  std::fprintf(stderr, "Executed %zu plans in %.3f s (summed over threads), %zu quads.\n", plans.size(), seconds,
+               quads);
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,660 @@
+#include "ra_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+static std::string g_result_str;
+
+namespace ra_executor {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Relational operators
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Above a join of a source with itself both sides have the same qualified
+// names, which can not be told apart
+int column_index(const Relation& relation, const std::string& name) {
+  int index = -1;
+  for (size_t i = 0; i < relation.columns.size(); ++i) {
+    if (relation.columns[i].name() != name) {
+      continue;
+    }
+    if (index >= 0) {
+      throw std::runtime_error("Ambiguous attribute '" + name + "'.");
+    }
+    index = i;
+  }
+  if (index < 0) {
+    throw std::runtime_error("Unknown attribute '" + name + "'.");
+  }
+  return index;
+}
+
+std::vector<int> column_indices(const Relation& relation, const std::vector<std::string>& names) {
+  std::vector<int> indices;
+  for (const auto& name : names) {
+    indices.push_back(column_index(relation, name));
+  }
+  return indices;
+}
+
+// Returns the rows of the input at the given positions
+Relation gather(const Relation& input, const std::vector<size_t>& rows) {
+  Relation result;
+  result.columns = input.columns;
+  result.rows = rows.size();
+  for (const auto& column : input.data) {
+    auto values = std::make_shared<std::vector<std::string>>();
+    values->reserve(rows.size());
+    for (size_t row : rows) {
+      values->push_back((*column)[row]);
+    }
+    result.data.push_back(values);
+  }
+  return result;
+}
+
+// Builds the key of a row over the columns. Returns false if a value is null,
+// i.e. empty, as null values never match in a join.
+bool row_key(const Relation& relation, const std::vector<int>& columns, size_t row, std::string& key,
+             bool allow_null = false) {
+  key.clear();
+  for (int column : columns) {
+    const std::string& value = (*relation.data[column])[row];
+    if (value.empty() && !allow_null) {
+      return false;
+    }
+    key += value;
+    key += '\0';
+  }
+  return true;
+}
+
+// Returns the rows of the input without a null value in the attributes
+Relation select_not_null(const Relation& input, const std::vector<std::string>& attributes) {
+  std::vector<int> columns = column_indices(input, attributes);
+  std::vector<size_t> rows;
+  std::string key;
+  for (size_t row = 0; row < input.rows; ++row) {
+    if (row_key(input, columns, row, key)) {
+      rows.push_back(row);
+    }
+  }
+  return gather(input, rows);
+}
+
+// Above a join, attributes are referenced with their source
+Relation qualify(Relation relation) {
+  for (auto& column : relation.columns) {
+    column.qualified = true;
+  }
+  return relation;
+}
+
+Relation scan_source(const std::string& source, SourceCache& sources) {
+  std::shared_ptr<const CsvTable> table = sources.get(source);
+  Relation relation;
+  relation.rows = table->rows();
+  for (size_t i = 0; i < table->header.size(); ++i) {
+    relation.columns.push_back({source, table->header[i], false});
+    relation.data.push_back(table->columns[i]);
+  }
+  relation.columns.push_back({source, row_id_attribute, false});
+  relation.data.push_back(table->row_ids);
+  return relation;
+}
+
+// Hash join, the right input is the build side as in the plans of the converter.
+// A join without conditions is a natural join on the attributes with the same name.
+Relation join(const PlanNode& node, Relation left, Relation right) {
+  std::vector<int> left_keys;
+  std::vector<int> right_keys;
+  bool natural = node.op == PlanOperator::Join && node.conditions.empty();
+  if (natural) {
+    for (size_t i = 0; i < right.columns.size(); ++i) {
+      for (size_t j = 0; j < left.columns.size(); ++j) {
+        if (left.columns[j].name() == right.columns[i].name()) {
+          left_keys.push_back(j);
+          right_keys.push_back(i);
+        }
+      }
+    }
+  } else {
+    Relation qualified_left = qualify(left);
+    Relation qualified_right = qualify(right);
+    for (const auto& condition : node.conditions) {
+      left_keys.push_back(column_index(qualified_left, condition[0]));
+      right_keys.push_back(column_index(qualified_right, condition[1]));
+    }
+    if (node.op == PlanOperator::Join) {
+      left = std::move(qualified_left);
+      right = std::move(qualified_right);
+    }
+  }
+
+  std::unordered_map<std::string, std::vector<size_t>> build;
+  std::string key;
+  for (size_t row = 0; row < right.rows; ++row) {
+    if (row_key(right, right_keys, row, key)) {
+      build[key].push_back(row);
+    }
+  }
+
+  std::vector<size_t> left_rows;
+  std::vector<size_t> right_rows;
+  for (size_t row = 0; row < left.rows; ++row) {
+    if (!row_key(left, left_keys, row, key)) {
+      continue;
+    }
+    auto it = build.find(key);
+    if (it == build.end()) {
+      continue;
+    }
+    if (node.op == PlanOperator::SemiJoin) {
+      left_rows.push_back(row);
+      continue;
+    }
+    for (size_t match : it->second) {
+      left_rows.push_back(row);
+      right_rows.push_back(match);
+    }
+  }
+
+  Relation result = gather(left, left_rows);
+  if (node.op == PlanOperator::SemiJoin) {
+    return result;
+  }
+
+  Relation matches = gather(right, right_rows);
+  for (size_t i = 0; i < matches.columns.size(); ++i) {
+    if (natural && std::find(right_keys.begin(), right_keys.end(), static_cast<int>(i)) != right_keys.end()) {
+      continue;
+    }
+    result.columns.push_back(matches.columns[i]);
+    result.data.push_back(matches.data[i]);
+  }
+  return result;
+}
+
+// Reads the attributes of the source records with the row IDs of the input
+Relation fetch(const PlanNode& node, Relation input, SourceCache& sources) {
+  std::shared_ptr<const CsvTable> table = sources.get(node.source);
+  const std::vector<std::string>& row_ids = *input.data[column_index(input, node.source + "_" + row_id_attribute)];
+
+  std::vector<int64_t> rows(input.rows);
+  for (size_t row = 0; row < input.rows; ++row) {
+    rows[row] = row_ids[row].empty() ? -1 : table->find_row(std::stoull(row_ids[row]));
+  }
+
+  for (const auto& attribute : node.attributes) {
+    auto it = std::find(table->header.begin(), table->header.end(), attribute);
+    if (it == table->header.end()) {
+      throw std::runtime_error("Source '" + node.source + "' has no column '" + attribute + "'.");
+    }
+    const std::vector<std::string>& column = *table->columns[it - table->header.begin()];
+
+    auto values = std::make_shared<std::vector<std::string>>();
+    values->reserve(input.rows);
+    for (int64_t row : rows) {
+      values->push_back(row < 0 ? "" : column[row]);
+    }
+    input.columns.push_back({node.source, attribute, true});
+    input.data.push_back(values);
+  }
+  return input;
+}
+
+Relation evaluate_relation(const PlanNode& node, SourceCache& sources) {
+  switch (node.op) {
+    case PlanOperator::Source:
+      return scan_source(node.source, sources);
+
+    case PlanOperator::Range: {
+      // Records starting in the range, the header is never part of one
+      Relation relation = scan_source(node.source, sources);
+      const std::vector<uint64_t>& offsets = sources.get(node.source)->offsets;
+      std::vector<size_t> rows;
+      for (size_t row = 0; row < offsets.size(); ++row) {
+        if (offsets[row] >= node.begin && offsets[row] < node.end) {
+          rows.push_back(row);
+        }
+      }
+      return gather(relation, rows);
+    }
+
+    case PlanOperator::Projection: {
+      Relation input = evaluate_relation(node.children[0], sources);
+      Relation result;
+      result.rows = input.rows;
+      for (int index : column_indices(input, node.attributes)) {
+        result.columns.push_back(input.columns[index]);
+        result.data.push_back(input.data[index]);
+      }
+      return result;
+    }
+
+    case PlanOperator::Selection:
+      return select_not_null(evaluate_relation(node.children[0], sources), node.attributes);
+
+    case PlanOperator::Distinct: {
+      Relation input = evaluate_relation(node.children[0], sources);
+      std::vector<int> columns(input.columns.size());
+      for (size_t i = 0; i < columns.size(); ++i) {
+        columns[i] = i;
+      }
+      std::unordered_set<std::string> seen;
+      std::vector<size_t> rows;
+      std::string key;
+      for (size_t row = 0; row < input.rows; ++row) {
+        row_key(input, columns, row, key, true);
+        if (seen.insert(key).second) {
+          rows.push_back(row);
+        }
+      }
+      return gather(input, rows);
+    }
+
+    case PlanOperator::Limit: {
+      Relation input = evaluate_relation(node.children[0], sources);
+      std::vector<size_t> rows(std::min<uint64_t>(input.rows, node.limit));
+      for (size_t row = 0; row < rows.size(); ++row) {
+        rows[row] = row;
+      }
+      return gather(input, rows);
+    }
+
+    case PlanOperator::Union: {
+      Relation left = evaluate_relation(node.children[0], sources);
+      Relation right = evaluate_relation(node.children[1], sources);
+      // Only the attributes of both inputs, as for the plan schema
+      Relation result;
+      result.rows = left.rows + right.rows;
+      for (size_t i = 0; i < left.columns.size(); ++i) {
+        auto it = std::find_if(right.columns.begin(), right.columns.end(),
+                               [&](const PlanColumn& column) { return column.name() == left.columns[i].name(); });
+        if (it == right.columns.end()) {
+          continue;
+        }
+        const Column& right_data = right.data[it - right.columns.begin()];
+        auto values = std::make_shared<std::vector<std::string>>(*left.data[i]);
+        values->insert(values->end(), right_data->begin(), right_data->end());
+        result.columns.push_back(left.columns[i]);
+        result.data.push_back(values);
+      }
+      return result;
+    }
+
+    case PlanOperator::Join:
+    case PlanOperator::SemiJoin:
+      return join(node, evaluate_relation(node.children[0], sources), evaluate_relation(node.children[1], sources));
+
+    case PlanOperator::Fetch:
+      return fetch(node, evaluate_relation(node.children[0], sources), sources);
+
+    default:
+      throw std::runtime_error("A create is used as input of a relational operator.");
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Term creation
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Percent-encodes every character except the IRI unreserved ones, as R2RML
+// requires for the values inserted into IRI templates
+std::string percent_encode(const std::string& value) {
+  static const char* hex = "0123456789ABCDEF";
+  std::string result;
+  for (unsigned char c : value) {
+    if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+      result += c;
+    } else {
+      result += '%';
+      result += hex[c >> 4];
+      result += hex[c & 15];
+    }
+  }
+  return result;
+}
+
+// Returns true if the IRI starts with a scheme, otherwise it is relative to the base IRI
+bool has_scheme(const std::string& iri) {
+  size_t colon = iri.find(':');
+  if (colon == std::string::npos || colon == 0 || !std::isalpha(static_cast<unsigned char>(iri[0]))) {
+    return false;
+  }
+  for (size_t i = 1; i < colon; ++i) {
+    unsigned char c = iri[i];
+    if (!std::isalnum(c) && c != '+' && c != '-' && c != '.') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the IRI can be written as N-Quads IRI reference
+bool is_valid_iri(const std::string& iri) {
+  for (unsigned char c : iri) {
+    if (c <= 0x20 || std::string("<>\"{}|^`\\").find(c) != std::string::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string escape_literal(const std::string& value) {
+  std::string result;
+  for (char c : value) {
+    switch (c) {
+      case '"': result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\n': result += "\\n"; break;
+      case '\r': result += "\\r"; break;
+      default: result += c;
+    }
+  }
+  return result;
+}
+
+// Blank node labels only keep letters and digits, other characters are written as hex codes
+std::string blank_node_label(const std::string& value) {
+  static const char* hex = "0123456789abcdef";
+  std::string result;
+  for (unsigned char c : value) {
+    if (std::isalnum(c)) {
+      result += c;
+    } else {
+      result += 'x';
+      result += hex[c >> 4];
+      result += hex[c & 15];
+    }
+  }
+  return result;
+}
+
+// A create term with its attributes resolved to the columns of the input
+struct BoundTerm {
+  const CreateTerm* term = nullptr;
+  std::vector<std::string> texts;  // templates: the text around the attributes, one more than columns
+  std::vector<int> columns;
+  std::string constant;            // the rendered constant, empty if it is not a valid term
+};
+
+bool render_value(const CreateTerm& term, std::string value, const ExecutorOptions& options, std::string& out) {
+  if (term.term_type == "iri") {
+    if (!has_scheme(value)) {
+      value = options.base_uri + value;
+    }
+    if (!is_valid_iri(value)) {
+      return false;
+    }
+    out += "<" + value + ">";
+  } else if (term.term_type == "blanknode") {
+    out += "_:" + blank_node_label(value);
+  } else {
+    out += "\"" + escape_literal(value) + "\"";
+    if (term.lang_tag != "None") {
+      out += "@" + term.lang_tag;
+    } else if (term.data_type != "None") {
+      out += "^^<" + term.data_type + ">";
+    }
+  }
+  return true;
+}
+
+BoundTerm bind_term(const CreateTerm& term, const Relation& input, const ExecutorOptions& options) {
+  BoundTerm bound;
+  bound.term = &term;
+  if (term.term_map_type == "constant") {
+    render_value(term, term.term_map, options, bound.constant);
+  } else if (term.term_map_type == "reference") {
+    bound.columns.push_back(column_index(input, term.term_map));
+  } else {
+    // An escaped brace is part of the text
+    std::string text;
+    for (size_t i = 0; i < term.term_map.size(); ++i) {
+      char c = term.term_map[i];
+      if (c == '\\' && i + 1 < term.term_map.size() && (term.term_map[i + 1] == '{' || term.term_map[i + 1] == '}')) {
+        text += term.term_map[++i];
+      } else if (c == '{') {
+        size_t end = term.term_map.find('}', i);
+        if (end == std::string::npos) {
+          throw std::runtime_error("Unterminated template '" + term.term_map + "'.");
+        }
+        bound.texts.push_back(text);
+        bound.columns.push_back(column_index(input, term.term_map.substr(i + 1, end - i - 1)));
+        text.clear();
+        i = end;
+      } else {
+        text += c;
+      }
+    }
+    bound.texts.push_back(text);
+  }
+  return bound;
+}
+
+// Appends the N-Quads form of the term for a row. Returns false if the term
+// is null, i.e. a referenced value is empty, or not a valid term.
+bool render_term(const BoundTerm& bound, const Relation& input, size_t row, const ExecutorOptions& options,
+                 std::string& out) {
+  const CreateTerm& term = *bound.term;
+  if (term.term_map_type == "constant") {
+    out += bound.constant;
+    return !bound.constant.empty();
+  }
+  if (term.term_map_type == "reference") {
+    const std::string& value = (*input.data[bound.columns[0]])[row];
+    return !value.empty() && render_value(term, value, options, out);
+  }
+
+  std::string value = bound.texts[0];
+  for (size_t i = 0; i < bound.columns.size(); ++i) {
+    const std::string& attribute = (*input.data[bound.columns[i]])[row];
+    if (attribute.empty()) {
+      return false;
+    }
+    value += term.term_type == "iri" ? percent_encode(attribute) : attribute;
+    value += bound.texts[i + 1];
+  }
+  return render_value(term, value, options, out);
+}
+
+// Creates a quad for every input row whose terms are all valid
+void create_quads(const std::vector<CreateTerm>& terms, const Relation& input, const ExecutorOptions& options,
+                  std::vector<std::string>& quads) {
+  std::vector<BoundTerm> bound;
+  for (char position : std::string("SPOG")) {
+    for (const auto& term : terms) {
+      if (term.position == position) {
+        bound.push_back(bind_term(term, input, options));
+      }
+    }
+  }
+
+  std::string quad;
+  for (size_t row = 0; row < input.rows; ++row) {
+    quad.clear();
+    bool valid = true;
+    for (size_t i = 0; i < bound.size() && valid; ++i) {
+      if (i > 0) {
+        quad += ' ';
+      }
+      valid = render_term(bound[i], input, row, options, quad);
+    }
+    if (valid) {
+      quads.push_back(quad + " .");
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Plan execution
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> execute_plan(const PlanNode& plan, SourceCache& sources, const ExecutorOptions& options) {
+  validate_plan(plan, [&sources](const std::string& source) { return sources.get(source)->header; });
+
+  std::vector<std::string> quads;
+  if (plan.op == PlanOperator::Constant) {
+    Relation unit;
+    unit.rows = 1;
+    create_quads(plan.heads[0], unit, options, quads);
+  } else if (plan.op == PlanOperator::Fork) {
+    Relation input = evaluate_relation(plan.children[0], sources);
+    for (size_t i = 0; i < plan.heads.size(); ++i) {
+      if (plan.head_filters[i].empty()) {
+        create_quads(plan.heads[i], input, options, quads);
+      } else {
+        create_quads(plan.heads[i], select_not_null(input, plan.head_filters[i]), options, quads);
+      }
+    }
+  } else {
+    // The constants of a bind are created with the terms of its create
+    std::vector<CreateTerm> terms = plan.heads[0];
+    const PlanNode* input = &plan.children[0];
+    if (plan.op == PlanOperator::Bind && input->op == PlanOperator::Create) {
+      terms.insert(terms.end(), input->heads[0].begin(), input->heads[0].end());
+      input = &input->children[0];
+    }
+    create_quads(terms, evaluate_relation(*input, sources), options, quads);
+  }
+
+  auto dedup = plan.annotations.find("dedup");
+  if (dedup != plan.annotations.end() && dedup->second == "false") {
+    return quads;
+  }
+
+  std::unordered_set<std::string> seen;
+  std::vector<std::string> unique_quads;
+  for (auto& quad : quads) {
+    if (seen.insert(quad).second) {
+      unique_quads.push_back(std::move(quad));
+    }
+  }
+  return unique_quads;
+}
+
+// Runs task(i) for i in [0, count) on a pool of num_threads workers
+void parallel_for(size_t count, unsigned int num_threads, const std::function<void(size_t)>& task) {
+  std::atomic<size_t> next_index{0};
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next_index.fetch_add(1)) < count) {
+      task(i);
+    }
+  };
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min<size_t>(num_threads, std::max<size_t>(1, count));
+
+  std::vector<std::thread> pool;
+  for (unsigned int t = 1; t < num_threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : pool) {
+    thread.join();
+  }
+}
+
+std::vector<PlanOutput> execute_plans(const std::vector<std::string>& plans, SourceCache& sources,
+                                      const ExecutorOptions& options) {
+  std::vector<PlanOutput> outputs(plans.size());
+  parallel_for(plans.size(), options.num_threads, [&](size_t i) {
+    auto start_time = std::chrono::steady_clock::now();
+    try {
+      outputs[i].quads = execute_plan(parse_plan(plans[i]), sources, options);
+    } catch (const std::exception& e) {
+      outputs[i].error = "Plan " + std::to_string(i + 1) + ": " + e.what();
+    }
+    outputs[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  });
+
+  if (!options.continue_on_error) {
+    for (const auto& output : outputs) {
+      if (!output.error.empty()) {
+        throw std::runtime_error(output.error);
+      }
+    }
+  }
+  return outputs;
+}
+
+size_t write_nquads(const std::vector<PlanOutput>& outputs, std::ostream& out) {
+  size_t count = 0;
+  for (const auto& output : outputs) {
+    for (const auto& quad : output.quads) {
+      out << quad << '\n';
+    }
+    count += output.quads.size();
+  }
+  return count;
+}
+
+}  // namespace ra_executor
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" {
+// Executes the plans, one per line, and appends their quads to the output
+// file, num_threads = 0 uses all cores. Returns "plans=N triples=N seconds=S"
+// or "Error: ...". Failed plans are reported on stderr with continue_on_error.
+const char* run_plans(const char* plans, const char* output_path, const char* base_uri, int num_threads,
+                      int continue_on_error) {
+  try {
+    auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::string> lines;
+    std::istringstream stream(plans);
+    std::string line;
+    while (std::getline(stream, line)) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (!line.empty()) {
+        lines.push_back(line);
+      }
+    }
+
+    ra_executor::ExecutorOptions options;
+    options.base_uri = base_uri;
+    options.num_threads = num_threads < 0 ? 0 : num_threads;
+    options.continue_on_error = continue_on_error != 0;
+
+    ra_executor::SourceCache sources;
+    std::vector<ra_executor::PlanOutput> outputs = ra_executor::execute_plans(lines, sources, options);
+    for (const auto& output : outputs) {
+      if (!output.error.empty()) {
+        std::cerr << "Error: " << output.error << std::endl;
+      }
+    }
+
+    std::ofstream file(output_path, std::ios::app);
+    size_t triples = ra_executor::write_nquads(outputs, file);
+    if (!file) {
+      throw std::runtime_error("Could not write file: " + std::string(output_path));
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    g_result_str = "plans=" + std::to_string(lines.size()) + " triples=" + std::to_string(triples) +
+                   " seconds=" + std::to_string(seconds);
+  } catch (const std::exception& e) {
+    g_result_str = "Error: " + std::string(e.what());
+  }
+
+  return g_result_str.c_str();
+}
+}
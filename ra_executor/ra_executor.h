@@ -0,0 +1,54 @@
+#ifndef RA_EXECUTOR_H
+#define RA_EXECUTOR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "csv_table.h"
+#include "plan_parser.h"
+
+namespace ra_executor {
+
+// Reference executor of the plans emitted by the converter. It evaluates the
+// plans over their CSV sources in memory and writes the created terms as
+// N-Quads. It is meant as a local baseline and correctness oracle for plan
+// rewrites, not as a replacement of the konverter backend.
+
+struct ExecutorOptions {
+  std::string base_uri = "http://example.com/base/";  // prefix of relative IRIs
+  unsigned int num_threads = 0;                       // plans executed in parallel, 0 uses all cores
+  bool continue_on_error = false;
+};
+
+// Result of one plan
+struct PlanOutput {
+  std::vector<std::string> quads;  // N-Quads statements without the newline
+  double seconds = 0;
+  std::string error;               // only set with continue_on_error
+};
+
+// Evaluates a relational node, i.e. every operator except the creates
+struct Relation {
+  std::vector<PlanColumn> columns;
+  std::vector<Column> data;  // one column per attribute
+  size_t rows = 0;
+};
+Relation evaluate_relation(const PlanNode& node, SourceCache& sources);
+
+// Executes a parsed plan. Duplicate quads are removed unless the plan is
+// annotated with dedup=false, the remaining quads keep the order of the rows.
+std::vector<std::string> execute_plan(const PlanNode& plan, SourceCache& sources, const ExecutorOptions& options);
+
+// Executes the plans, one per line, on a pool of options.num_threads workers
+// with one plan per task. The outputs are in plan order. Without
+// continue_on_error, the error of the first failing plan is thrown.
+std::vector<PlanOutput> execute_plans(const std::vector<std::string>& plans, SourceCache& sources,
+                                      const ExecutorOptions& options);
+
+// Writes the quads of all outputs in plan order, returns their number
+size_t write_nquads(const std::vector<PlanOutput>& outputs, std::ostream& out);
+
+}  // namespace ra_executor
+
+#endif
@@ -9,6 +9,12 @@ struct NTriple {
   std::string subject;
   std::string predicate;
   std::string object;
+
+  bool operator==(const NTriple& other) const {
+    return subject == other.subject &&
+           predicate == other.predicate &&
+           object == other.object;
+  }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "compile_daemon.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "rml_compiler.h"
+
+namespace rml_compiler {
+
+// Path of the socket served by this process, removed on termination
+static char g_socket_path[sizeof(sockaddr_un::sun_path)];
+
+// Time a client has to send its request, and to accept each part of the
+// response. The daemon serves one client at a time, so a client that stalls
+// must not block the others.
+constexpr int request_timeout_ms = 10000;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Socket helpers
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool make_socket_address(const std::string& socket_path, sockaddr_un& address) {
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size());
+  return true;
+}
+
+// Reads until the peer shuts down its writing side. Returns false on an
+// error or if the peer did not finish within timeout_ms, -1 waits forever.
+bool read_all(int fd, std::string& data, int timeout_ms = -1) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  char buffer[64 * 1024];
+  while (true) {
+    if (timeout_ms >= 0) {
+      auto remaining =
+          std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+      pollfd poll_fd = {fd, POLLIN, 0};
+      int ready = remaining > 0 ? poll(&poll_fd, 1, remaining) : 0;
+      if (ready < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ready <= 0) {
+        return false;
+      }
+    }
+
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if (count == 0) {
+      return true;
+    }
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.append(buffer, count);
+  }
+}
+
+bool write_all(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t count = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += count;
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Daemon
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void handle_termination(int signal_number) {
+  unlink(g_socket_path);
+  _exit(128 + signal_number);
+}
+
+// Answers a compile request on the client connection
+void handle_compile_request(int client, const std::string& request) {
+  std::string mapping_path;
+  std::string cwd;
+  std::string options;
+  bool stream = false;
+
+  std::istringstream stream_lines(request);
+  std::string line;
+  while (std::getline(stream_lines, line)) {
+    if (line.starts_with("mapping=")) {
+      mapping_path = line.substr(8);
+    } else if (line.starts_with("cwd=")) {
+      cwd = line.substr(4);
+    } else if (line == "stream=true") {
+      stream = true;
+    } else {
+      options += line + "\n";
+    }
+  }
+
+  try {
+    if (mapping_path.empty()) {
+      throw std::invalid_argument("Missing mapping in compile request.");
+    }
+    if (!cwd.empty()) {
+      std::filesystem::current_path(cwd);
+    }
+
+    reset_options();
+    CompileOptions compile_options;
+    apply_options(options, compile_options);
+    if (stream) {
+      // A client that went away only stops receiving, the caches are still updated
+      compile_mapping_stream(mapping_path, compile_options, [client](const std::string& plans) { write_all(client, plans); });
+    } else {
+      write_all(client, compile_mapping(mapping_path, compile_options));
+    }
+  } catch (const std::exception& e) {
+    // Streamed plans end with a newline, so the error starts a line of its own
+    write_all(client, "Error: " + std::string(e.what()) + (stream ? "\n" : ""));
+  }
+}
+
+int run_compile_daemon(const std::string& socket_path) {
+  sockaddr_un address;
+  if (!make_socket_address(socket_path, address)) {
+    std::cerr << "Error: Socket path too long: " << socket_path << std::endl;
+    return 1;
+  }
+
+  // A socket file nobody listens on is left over from a terminated daemon
+  int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+    close(probe);
+    std::cerr << "Error: A daemon is already listening on " << socket_path << std::endl;
+    return 1;
+  }
+  close(probe);
+  unlink(socket_path.c_str());
+
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0 || bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(server, SOMAXCONN) != 0) {
+    std::cerr << "Error: Could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+
+  std::memcpy(g_socket_path, address.sun_path, sizeof(g_socket_path));
+  signal(SIGINT, handle_termination);
+  signal(SIGTERM, handle_termination);
+
+  while (true) {
+    int client = accept(server, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      std::cerr << "Error: Could not accept connections: " << std::strerror(errno) << std::endl;
+      break;
+    }
+
+    // A response the client does not read fails the send instead of blocking
+    timeval send_timeout = {request_timeout_ms / 1000, 0};
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    std::string request;
+    if (read_all(client, request, request_timeout_ms)) {
+      handle_compile_request(client, request);
+    } else {
+      write_all(client, "Error: No complete compile request received.");
+    }
+    close(client);
+  }
+
+  close(server);
+  unlink(socket_path.c_str());
+  return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Client
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns a socket connected to the daemon, throws std::runtime_error if it cannot be reached
+int connect_to_daemon(const std::string& socket_path) {
+  sockaddr_un address;
+  if (!make_socket_address(socket_path, address)) {
+    throw std::runtime_error("Socket path too long: " + socket_path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    std::string reason = std::strerror(errno);
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::runtime_error("Could not connect to the compile daemon at " + socket_path + ": " + reason);
+  }
+  return fd;
+}
+
+std::string create_request(const std::string& mapping_path, const std::string& options, bool stream) {
+  std::error_code ec;
+  return "mapping=" + mapping_path + "\ncwd=" + std::filesystem::current_path(ec).string() + "\n" +
+         (stream ? "stream=true\n" : "") + options;
+}
+
+std::string request_compile(const std::string& socket_path, const std::string& mapping_path,
+                            const std::string& options) {
+  int fd = connect_to_daemon(socket_path);
+
+  std::string response;
+  bool success = write_all(fd, create_request(mapping_path, options, false)) && shutdown(fd, SHUT_WR) == 0 &&
+                 read_all(fd, response);
+  close(fd);
+  if (!success) {
+    throw std::runtime_error("Lost the connection to the compile daemon at " + socket_path);
+  }
+  return response;
+}
+
+void request_compile_stream(const std::string& socket_path, const std::string& mapping_path,
+                            const std::string& options, const PlanCallback& emit) {
+  int fd = connect_to_daemon(socket_path);
+  if (!write_all(fd, create_request(mapping_path, options, true)) || shutdown(fd, SHUT_WR) != 0) {
+    close(fd);
+    throw std::runtime_error("Lost the connection to the compile daemon at " + socket_path);
+  }
+
+  // Complete plans are passed on as they arrive, a failed compilation ends with an error line
+  std::string pending;
+  bool failed = false;
+  char buffer[64 * 1024];
+  while (true) {
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      close(fd);
+      throw std::runtime_error("Lost the connection to the compile daemon at " + socket_path);
+    }
+    if (count == 0) {
+      break;
+    }
+
+    pending.append(buffer, count);
+    if (failed) {
+      continue;
+    }
+    size_t start = 0;
+    for (size_t end; (end = pending.find('\n', start)) != std::string::npos; start = end + 1) {
+      if (pending.compare(start, 6, "Error:") == 0) {
+        failed = true;
+        break;
+      }
+    }
+    if (start > 0) {
+      emit(pending.substr(0, start));
+      pending.erase(0, start);
+    }
+  }
+  close(fd);
+
+  if (failed || pending.starts_with("Error:")) {
+    while (!pending.empty() && pending.back() == '\n') {
+      pending.pop_back();
+    }
+    throw std::runtime_error(pending.substr(pending.starts_with("Error: ") ? 7 : 6));
+  }
+  if (!pending.empty()) {
+    emit(pending);
+  }
+}
+
+}  // namespace rml_compiler
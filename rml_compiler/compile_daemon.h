@@ -0,0 +1,39 @@
+#ifndef COMPILE_DAEMON_H
+#define COMPILE_DAEMON_H
+
+#include <string>
+
+#include "rml_compiler.h"
+
+namespace rml_compiler {
+
+// Protocol:
+//   The client connects to the Unix socket, sends "key=value" lines and shuts
+//   down its writing side. The mapping key gives the mapping file and the cwd
+//   key the directory relative paths are resolved against, all other lines
+//   are compile options. The daemon answers with the plans or "Error: ..."
+//   and closes the connection. With the line "stream=true" the plans are
+//   sent while the mapping is compiled, see compile_mapping_stream, and a
+//   failed compilation ends with the line "Error: ...".
+
+// Serves compile requests on the socket until the process is terminated.
+// Requests are compiled one at a time, as options and working directory are
+// process wide, and each starts from the default options. The libraries and
+// the caches stay loaded between requests. Returns 1 if the socket cannot be
+// opened, e.g. because another daemon is listening on it.
+int run_compile_daemon(const std::string& socket_path);
+
+// Sends a compile request to the daemon listening on the socket and returns
+// its answer. Throws std::runtime_error if the daemon cannot be reached.
+std::string request_compile(const std::string& socket_path, const std::string& mapping_path,
+                            const std::string& options);
+
+// Sends a streaming compile request and passes the plans to emit as they
+// arrive. Throws std::runtime_error if the daemon cannot be reached or the
+// mapping cannot be compiled.
+void request_compile_stream(const std::string& socket_path, const std::string& mapping_path,
+                            const std::string& options, const PlanCallback& emit);
+
+}  // namespace rml_compiler
+
+#endif
@@ -0,0 +1,67 @@
+#include "incremental_compiler.h"
+
+#include <set>
+
+#include "../rdf_parser/rdf_parser.h"
+#include "mapping_partition.h"
+
+namespace rml_compiler {
+
+const std::string source_predicate = "http://semweb.mmlab.be/ns/rml#source";
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Incremental compiler
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+IncrementalCompiler::IncrementalCompiler(const std::string& mapping_path, const CompileOptions& compile_options)
+    : mapping_path(mapping_path), compile_options(compile_options) {}
+
+std::string IncrementalCompiler::compile() {
+  RDFParser parser;
+  std::vector<NTriple> triples = parser.parse(read_mapping_file(mapping_path));
+
+  std::vector<TriplesMapInput> inputs = partition_mapping(triples);
+
+  // Triples maps whose input did not change keep their subgraphs
+  std::unordered_map<std::string, TriplesMapState> next_triples_maps;
+  CompileStatistics next_statistics;
+  next_statistics.triples_maps = inputs.size();
+  for (const auto& input : inputs) {
+    auto it = triples_maps.find(input.triples_map);
+    if (it != triples_maps.end() && it->second.key == input.key) {
+      next_triples_maps[input.triples_map] = it->second;
+      continue;
+    }
+
+    auto sub_graphs = std::make_shared<std::vector<std::vector<NTriple>>>(
+        normalize_triples_map(triples, input, compile_options.bn_number));
+    next_triples_maps[input.triples_map] = {input.key, sub_graphs};
+    next_statistics.normalized++;
+  }
+
+  std::vector<std::vector<NTriple>> sub_graphs;
+  std::set<std::string> next_sources;
+  for (const auto& input : inputs) {
+    for (const auto& sub_graph : *next_triples_maps[input.triples_map].sub_graphs) {
+      sub_graphs.push_back(sub_graph);
+      for (const auto& triple : sub_graph) {
+        if (triple.predicate == source_predicate) {
+          next_sources.insert(triple.object);
+        }
+      }
+    }
+  }
+
+  ra_converter::sort_sub_graphs(sub_graphs);
+  std::string plans = ra_converter::convert_sub_graphs(sub_graphs, compile_options.num_threads, &memo);
+  ra_converter::save_caches();
+
+  next_statistics.plans = memo.reused + memo.converted;
+  next_statistics.converted = memo.converted;
+  triples_maps = std::move(next_triples_maps);
+  sources.assign(next_sources.begin(), next_sources.end());
+  statistics = next_statistics;
+  return plans;
+}
+
+}  // namespace rml_compiler
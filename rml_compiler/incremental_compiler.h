@@ -0,0 +1,59 @@
+#ifndef INCREMENTAL_COMPILER_H
+#define INCREMENTAL_COMPILER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../ra_converter/ra_converter_rml_io.h"
+#include "rml_compiler.h"
+
+namespace rml_compiler {
+
+// Work done by the last compilation
+struct CompileStatistics {
+  size_t triples_maps = 0;  // triples maps of the mapping
+  size_t normalized = 0;    // triples maps normalized again
+  size_t plans = 0;         // plan groups of the mapping
+  size_t converted = 0;     // plan groups converted again
+};
+
+// Compiles successive versions of a mapping file and reuses the work done for
+// the previous version. Every triples map is normalized on its own, together
+// with its parent triples maps, and only again if its triples or the triples
+// of a parent changed. Plan groups are only converted again if their
+// subgraphs or sources changed. The mapping file is parsed completely.
+//
+// The plans are those of compile_mapping, except that plans shared by several
+// triples maps may list their branches in another order, as the names the
+// normalizer generates differ between the two.
+class IncrementalCompiler {
+ private:
+  struct TriplesMapState {
+    std::string key;  // triples of the map and its parents, with renumbered blank nodes
+    std::shared_ptr<const std::vector<std::vector<NTriple>>> sub_graphs;
+  };
+
+  std::string mapping_path;
+  CompileOptions compile_options;
+  std::unordered_map<std::string, TriplesMapState> triples_maps;
+  ra_converter::PlanMemo memo;
+  std::vector<std::string> sources;
+  CompileStatistics statistics;
+
+ public:
+  IncrementalCompiler(const std::string& mapping_path, const CompileOptions& compile_options);
+
+  // Compiles the current version of the mapping file. Throws std::exception on
+  // invalid mappings and keeps the state of the last successful compilation.
+  std::string compile();
+
+  // Sources referenced by the last compiled version
+  const std::vector<std::string>& get_sources() const { return sources; }
+  const CompileStatistics& get_statistics() const { return statistics; }
+};
+
+}  // namespace rml_compiler
+
+#endif
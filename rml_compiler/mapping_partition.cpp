@@ -0,0 +1,153 @@
+#include "mapping_partition.h"
+
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../rml_normalizer/rml_io_normalizer.h"
+
+namespace rml_compiler {
+
+const std::string rdf_type_predicate = "http://www.w3.org/1999/02/22-rdf-syntax-ns#type";
+const std::string triples_map_type = "http://www.w3.org/ns/r2rml#TriplesMap";
+const std::string parent_triples_map_predicate = "http://www.w3.org/ns/r2rml#parentTriplesMap";
+
+// Length of the suffix the normalizer appends to the triples maps it splits off
+const size_t split_suffix_length = 16;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Triples map closures
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Triples of a mapping indexed by subject
+struct MappingIndex {
+  const std::vector<NTriple>& triples;
+  std::unordered_map<std::string, std::vector<size_t>> by_subject;
+  std::unordered_set<std::string> triples_maps;
+};
+
+// Returns the triples reachable from a triples map without entering another
+// triples map, in order of traversal
+std::vector<size_t> get_closure(const MappingIndex& index, const std::string& triples_map) {
+  std::vector<size_t> closure;
+  std::unordered_set<std::string> visited{triples_map};
+  std::vector<std::string> stack{triples_map};
+
+  while (!stack.empty()) {
+    std::string node = stack.back();
+    stack.pop_back();
+
+    auto it = index.by_subject.find(node);
+    if (it == index.by_subject.end()) {
+      continue;
+    }
+    for (size_t i : it->second) {
+      closure.push_back(i);
+      const std::string& object = index.triples[i].object;
+      if (index.by_subject.contains(object) && !index.triples_maps.contains(object) && visited.insert(object).second) {
+        stack.push_back(object);
+      }
+    }
+  }
+
+  return closure;
+}
+
+// Returns the text of a closure with its inner blank nodes numbered in order of
+// appearance, so the parser's numbering of the other blank nodes does not matter
+std::string get_closure_key(const MappingIndex& index, const std::vector<size_t>& closure) {
+  std::unordered_map<std::string, std::string> names;
+  auto name = [&](const std::string& node) -> std::string {
+    if (node.starts_with("http://") || node.starts_with("https://") || !index.by_subject.contains(node)) {
+      return node;
+    }
+    auto [it, inserted] = names.try_emplace(node, "_:" + std::to_string(names.size()));
+    return it->second;
+  };
+
+  std::string key;
+  for (size_t i : closure) {
+    const NTriple& triple = index.triples[i];
+    key += name(triple.subject) + "|||" + triple.predicate + "|||" + name(triple.object) + "\n";
+  }
+  return key;
+}
+
+// Returns true if a normalized subgraph belongs to the triples map, i.e. is
+// rooted at the map or at a map split off from it
+bool is_sub_graph_of(const std::vector<NTriple>& sub_graph, const std::string& triples_map) {
+  if (sub_graph.empty()) {
+    return false;
+  }
+  const std::string& root = sub_graph[0].subject;
+  return root == triples_map ||
+         (root.size() == triples_map.size() + split_suffix_length && root.starts_with(triples_map));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Partitioning
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TriplesMapInput> partition_mapping(const std::vector<NTriple>& triples) {
+  MappingIndex index{triples, {}, {}};
+  std::vector<std::string> triples_map_order;
+  for (size_t i = 0; i < triples.size(); ++i) {
+    index.by_subject[triples[i].subject].push_back(i);
+    if (triples[i].predicate == rdf_type_predicate && triples[i].object == triples_map_type &&
+        index.triples_maps.insert(triples[i].subject).second) {
+      triples_map_order.push_back(triples[i].subject);
+    }
+  }
+  if (triples_map_order.empty()) {
+    throw std::runtime_error("No TMs found.");
+  }
+
+  std::unordered_map<std::string, std::vector<size_t>> closures;
+  std::unordered_map<std::string, std::string> closure_keys;
+  for (const auto& triples_map : triples_map_order) {
+    closures[triples_map] = get_closure(index, triples_map);
+    closure_keys[triples_map] = get_closure_key(index, closures[triples_map]);
+  }
+
+  // Triples maps are normalized with their parents, which are part of the key
+  std::vector<TriplesMapInput> inputs;
+  inputs.reserve(triples_map_order.size());
+  for (const auto& triples_map : triples_map_order) {
+    const std::vector<size_t>& closure = closures[triples_map];
+
+    std::set<size_t> input_indices(closure.begin(), closure.end());
+    std::string key = closure_keys[triples_map];
+    for (size_t i : closure) {
+      const NTriple& triple = triples[i];
+      if (triple.predicate == parent_triples_map_predicate && closures.contains(triple.object)) {
+        const std::vector<size_t>& parent_closure = closures[triple.object];
+        input_indices.insert(parent_closure.begin(), parent_closure.end());
+        key += "----\n" + closure_keys[triple.object];
+      }
+    }
+
+    inputs.push_back({triples_map, std::move(key), {input_indices.begin(), input_indices.end()}});
+  }
+  return inputs;
+}
+
+std::vector<std::vector<NTriple>> normalize_triples_map(const std::vector<NTriple>& triples,
+                                                        const TriplesMapInput& input, int bn_number) {
+  std::vector<NTriple> input_triples;
+  input_triples.reserve(input.triples.size());
+  for (size_t i : input.triples) {
+    input_triples.push_back(triples[i]);
+  }
+  rml_normalizer::validator(input_triples);
+
+  std::vector<std::vector<NTriple>> sub_graphs;
+  rml_normalizer::normalize_mapping(input_triples, bn_number, [&](std::vector<NTriple>&& sub_graph) {
+    if (is_sub_graph_of(sub_graph, input.triples_map)) {
+      sub_graphs.push_back(std::move(sub_graph));
+    }
+  });
+  return sub_graphs;
+}
+
+}  // namespace rml_compiler
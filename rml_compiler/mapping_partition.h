@@ -0,0 +1,32 @@
+#ifndef MAPPING_PARTITION_H
+#define MAPPING_PARTITION_H
+
+#include <string>
+#include <vector>
+
+#include "../rdf_parser/definitions.h"
+
+namespace rml_compiler {
+
+// Triples a triples map is normalized from: the triples reachable from the map
+// without entering another triples map, and those of its parent triples maps
+struct TriplesMapInput {
+  std::string triples_map;
+  std::string key;              // input triples with renumbered blank nodes
+  std::vector<size_t> triples;  // indices into the mapping, in mapping order
+};
+
+// Splits a parsed mapping into the inputs of its triples maps, in the order the
+// triples maps are declared. Throws std::runtime_error if it has none.
+std::vector<TriplesMapInput> partition_mapping(const std::vector<NTriple>& triples);
+
+// Validates and normalizes a triples map on its own and returns the subgraphs
+// rooted at the map or at a map the normalizer split off from it. Together,
+// the subgraphs of all triples maps are those of the complete mapping, up to
+// the names of generated nodes.
+std::vector<std::vector<NTriple>> normalize_triples_map(const std::vector<NTriple>& triples,
+                                                        const TriplesMapInput& input, int bn_number);
+
+}  // namespace rml_compiler
+
+#endif
@@ -0,0 +1,141 @@
+#include "plan_cache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "../ra_converter/source_statistics.h"
+
+PlanDependency get_plan_dependency(const std::string& path) {
+  std::error_code ec;
+  PlanDependency dependency;
+  dependency.path = std::filesystem::absolute(path, ec).string();
+
+  uint64_t size = std::filesystem::file_size(path, ec);
+  if (!ec && get_file_mtime(path, dependency.mtime)) {
+    dependency.size = size;
+  }
+  return dependency;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Plan cache
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PlanCache::set_cache_dir(const std::string& dir) {
+  std::lock_guard<std::mutex> lock(mutex);
+  cache_dir = dir;
+}
+
+bool PlanCache::enabled() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !cache_dir.empty();
+}
+
+std::string PlanCache::entry_path(const std::string& key) const {
+  std::ostringstream name;
+  name << std::hex << hash_value(key) << ".plan";
+  return (std::filesystem::path(cache_dir) / name.str()).string();
+}
+
+// Format:
+//   plan_cache <tab> 2
+//   K <tab> key length
+//   key ...                                   (followed by a newline)
+//   D <tab> path <tab> size <tab> mtime      (once per dependency)
+//   P
+//   plans ...
+bool PlanCache::get(const std::string& key, std::string& plans) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache_dir.empty()) {
+    return false;
+  }
+
+  std::ifstream file(entry_path(key), std::ios::in | std::ios::binary);
+  std::string line;
+  if (!std::getline(file, line) || line != "plan_cache\t2") {
+    return false;
+  }
+
+  // Another key with the same hash
+  if (!std::getline(file, line) || line != "K\t" + std::to_string(key.size())) {
+    return false;
+  }
+  std::string entry_key(key.size(), '\0');
+  if (!file.read(entry_key.data(), entry_key.size()) || entry_key != key || file.get() != '\n') {
+    return false;
+  }
+
+  while (std::getline(file, line) && line != "P") {
+    std::vector<std::string> parts;
+    std::istringstream stream(line);
+    std::string part;
+    while (std::getline(stream, part, '\t')) {
+      parts.push_back(part);
+    }
+    if (parts.size() != 4 || parts[0] != "D") {
+      return false;
+    }
+
+    PlanDependency dependency = get_plan_dependency(parts[1]);
+    if (std::to_string(dependency.size) != parts[2] || std::to_string(dependency.mtime) != parts[3]) {
+      return false;
+    }
+  }
+  if (line != "P") {
+    return false;
+  }
+
+  plans.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+void PlanCache::put(const std::string& key, const std::string& plans, const std::vector<PlanDependency>& dependencies) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache_dir.empty()) {
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(cache_dir, ec);
+
+  // Written to a temporary file first, so concurrent readers never see a partial entry
+  std::string path = entry_path(key);
+  std::string tmp_path = path + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::trunc | std::ios::binary);
+    if (!file) {
+      return;
+    }
+    file << "plan_cache\t2\n";
+    file << "K\t" << key.size() << "\n" << key << "\n";
+    for (const auto& dependency : dependencies) {
+      file << "D\t" << dependency.path << "\t" << dependency.size << "\t" << dependency.mtime << "\n";
+    }
+    file << "P\n" << plans;
+  }
+  std::filesystem::rename(tmp_path, path, ec);
+
+  prune();
+}
+
+void PlanCache::prune() {
+  std::error_code ec;
+  std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+  for (const auto& entry : std::filesystem::directory_iterator(cache_dir, ec)) {
+    if (entry.path().extension() == ".plan") {
+      entries.emplace_back(entry.last_write_time(ec), entry.path());
+    }
+  }
+  if (entries.size() <= max_entries) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end());
+  for (size_t i = 0; i < entries.size() - max_entries; ++i) {
+    std::filesystem::remove(entries[i].second, ec);
+  }
+}
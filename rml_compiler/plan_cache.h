@@ -0,0 +1,45 @@
+#ifndef PLAN_CACHE_H
+#define PLAN_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A file a cached plan depends on, e.g. a source or the plan profile
+struct PlanDependency {
+  std::string path;  // absolute path
+  int64_t size = -1;  // -1 if the file does not exist
+  int64_t mtime = 0;
+};
+
+// Returns the dependency on the current state of a file
+PlanDependency get_plan_dependency(const std::string& path);
+
+// Plans of previously compiled mappings, one file per entry in the cache
+// directory. Entries are keyed by everything the compilation reads besides
+// files, i.e. the mapping content, the options and the build. The file of an
+// entry is named by the hash of its key and holds the key itself, so entries
+// whose keys only share the hash are not mixed up. An entry is only used
+// while all files it depends on are unchanged. The least recently written
+// entries are removed beyond max_entries.
+class PlanCache {
+ private:
+  std::string cache_dir;
+  std::mutex mutex;
+
+  std::string entry_path(const std::string& key) const;
+  void prune();
+
+ public:
+  static const size_t max_entries = 256;
+
+  void set_cache_dir(const std::string& dir);
+  bool enabled();
+
+  // Returns false if there is no valid entry for the key
+  bool get(const std::string& key, std::string& plans);
+  void put(const std::string& key, const std::string& plans, const std::vector<PlanDependency>& dependencies);
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "compile_daemon.h"
+#include "rml_compiler.h"
+#include "watch.h"
+
+void print_usage() {
+  std::cerr << "Usage: rml_compile [-s socket] [--stream] [-o key=value]... [-w plan_file] mapping_file" << std::endl
+            << "       rml_compile --watch [-o key=value]... [-w plan_file] mapping_file" << std::endl
+            << "       rml_compile --daemon socket" << std::endl
+            << std::endl
+            << "Compiles an RML mapping into relational algebra plans, one per line." << std::endl
+            << "Options are bn_number, threads, plan_cache and the options of the converter." << std::endl
+            << "With -s the mapping is compiled by the daemon listening on the socket." << std::endl
+            << "With --stream the plans are written while the mapping is compiled, grouped" << std::endl
+            << "and ordered only among the plans converted together." << std::endl
+            << "With --watch the mapping is compiled again whenever it or its sources change," << std::endl
+            << "and the new plans of every compilation are printed." << std::endl;
+}
+
+// Writes the plans as they are converted, so a consumer can start executing them
+int stream_plans(const std::string& mapping_path, const std::string& options, const std::string& socket_path,
+                 const std::string& plan_path) {
+  std::ofstream file;
+  if (!plan_path.empty()) {
+    file.open(plan_path, std::ios::trunc);
+  }
+  std::ostream& out = plan_path.empty() ? std::cout : file;
+  auto emit = [&out](const std::string& plans) { out << plans << std::flush; };
+
+  try {
+    if (socket_path.empty()) {
+      rml_compiler::CompileOptions compile_options;
+      rml_compiler::apply_options(options, compile_options);
+      rml_compiler::compile_mapping_stream(mapping_path, compile_options, emit);
+    } else {
+      rml_compiler::request_compile_stream(socket_path, mapping_path, options, emit);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  if (!out) {
+    std::cerr << "Error: Could not write file: " << plan_path << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  std::string mapping_path;
+  std::string plan_path;
+  std::string socket_path;
+  std::string options;
+  bool watch = false;
+  bool stream = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if ((std::strcmp(argv[i], "-o") == 0 || std::strcmp(argv[i], "--option") == 0) && i + 1 < argc) {
+      options += std::string(argv[++i]) + "\n";
+    } else if ((std::strcmp(argv[i], "-w") == 0 || std::strcmp(argv[i], "--write") == 0) && i + 1 < argc) {
+      plan_path = argv[++i];
+    } else if ((std::strcmp(argv[i], "-s") == 0 || std::strcmp(argv[i], "--socket") == 0) && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--stream") == 0) {
+      stream = true;
+    } else if (std::strcmp(argv[i], "--watch") == 0) {
+      watch = true;
+    } else if (std::strcmp(argv[i], "--daemon") == 0 && i + 1 < argc) {
+      return rml_compiler::run_compile_daemon(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+      print_usage();
+      return 0;
+    } else if (mapping_path.empty() && argv[i][0] != '-') {
+      mapping_path = argv[i];
+    } else {
+      print_usage();
+      return 2;
+    }
+  }
+  if (mapping_path.empty()) {
+    print_usage();
+    return 2;
+  }
+
+  if (stream) {
+    return stream_plans(mapping_path, options, socket_path, plan_path);
+  }
+
+  std::string plans;
+  try {
+    if (watch) {
+      rml_compiler::CompileOptions compile_options;
+      rml_compiler::apply_options(options, compile_options);
+      return rml_compiler::watch_mapping(mapping_path, compile_options, plan_path);
+    }
+    if (socket_path.empty()) {
+      rml_compiler::CompileOptions compile_options;
+      rml_compiler::apply_options(options, compile_options);
+      plans = rml_compiler::compile_mapping(mapping_path, compile_options);
+    } else {
+      plans = rml_compiler::request_compile(socket_path, mapping_path, options);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  if (plans.starts_with("Error:")) {
+    std::cerr << plans << std::endl;
+    return 1;
+  }
+
+  if (plan_path.empty()) {
+    std::cout << plans;
+    return 0;
+  }
+
+  std::ofstream file(plan_path, std::ios::trunc);
+  if (!(file << plans)) {
+    std::cerr << "Error: Could not write file: " << plan_path << std::endl;
+    return 1;
+  }
+  return 0;
+}
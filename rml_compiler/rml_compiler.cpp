@@ -0,0 +1,325 @@
+#include "rml_compiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../ra_converter/ra_converter_rml_io.h"
+#include "../ra_converter/source_statistics.h"
+#include "../rdf_parser/rdf_parser.h"
+#include "../rml_normalizer/rml_io_normalizer.h"
+#include "mapping_partition.h"
+#include "plan_cache.h"
+
+// The build scripts compile all sources at once, so the build time identifies the build
+#ifndef RML_BUILD_VERSION
+#define RML_BUILD_VERSION __DATE__ " " __TIME__
+#endif
+
+namespace rml_compiler {
+
+// used to store string result
+static std::string g_result_str;
+
+// Plans of previous compilations
+static PlanCache g_plan_cache;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Options
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void apply_options(const std::string& options, CompileOptions& compile_options) {
+  std::istringstream stream(options);
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.empty()) {
+      continue;
+    }
+
+    size_t pos = line.find('=');
+    if (pos == std::string::npos) {
+      throw std::invalid_argument("Invalid option '" + line + "', expected key=value.");
+    }
+    std::string key = line.substr(0, pos);
+    std::string value = line.substr(pos + 1);
+
+    try {
+      if (key == "bn_number") {
+        compile_options.bn_number = std::stoi(value);
+        continue;
+      }
+      if (key == "threads") {
+        compile_options.num_threads = std::stoul(value);
+        continue;
+      }
+    } catch (const std::exception&) {
+      throw std::invalid_argument("Invalid value '" + value + "' of option '" + key + "'.");
+    }
+    if (key == "plan_cache") {
+      g_plan_cache.set_cache_dir(value);
+      continue;
+    }
+
+    if (ra_converter::set_converter_option(key.c_str(), value.c_str()) != 0) {
+      throw std::invalid_argument("Invalid converter option '" + key + "' or value '" + value + "'.");
+    }
+    compile_options.plan_options += line + "\n";
+    if (key == "plan_profile") {
+      // Measured plans are ordered by their measurements
+      compile_options.dependencies.push_back(value);
+    }
+  }
+}
+
+void reset_options() {
+  ra_converter::reset_converter_options();
+  g_plan_cache.set_cache_dir("");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Pipeline
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string read_mapping_file(const std::string& mapping_path) {
+  std::ifstream file(mapping_path, std::ios::in | std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open file: " + mapping_path);
+  }
+  return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// Returns the key of the plans of a mapping in the plan cache. Relative
+// sources are resolved against the working directory, so it is part of the key.
+std::string plan_cache_key(const std::string& mapping, const CompileOptions& compile_options) {
+  std::error_code ec;
+  return std::string(RML_BUILD_VERSION) + "\n" + std::filesystem::current_path(ec).string() + "\n" +
+         std::to_string(compile_options.bn_number) + "\n" + compile_options.plan_options + "\n" + mapping;
+}
+
+// Adds the files the plans of the subgraphs depend on, files already added keep their state
+void add_plan_dependencies(const std::vector<std::vector<NTriple>>& sub_graphs, const CompileOptions& compile_options,
+                           std::map<std::string, PlanDependency>& dependencies) {
+  std::set<std::string> paths(compile_options.dependencies.begin(), compile_options.dependencies.end());
+  for (const auto& sub_graph : sub_graphs) {
+    for (const auto& triple : sub_graph) {
+      if (triple.predicate == "http://semweb.mmlab.be/ns/rml#source") {
+        paths.insert(triple.object);
+      }
+    }
+  }
+
+  for (const auto& path : paths) {
+    if (!dependencies.contains(path)) {
+      dependencies[path] = get_plan_dependency(path);
+    }
+  }
+}
+
+std::vector<PlanDependency> get_dependency_list(const std::map<std::string, PlanDependency>& dependencies) {
+  std::vector<PlanDependency> list;
+  for (const auto& [path, dependency] : dependencies) {
+    list.push_back(dependency);
+  }
+  return list;
+}
+
+std::string compile_mapping(const std::string& mapping_path, const CompileOptions& compile_options) {
+  std::string mapping = read_mapping_file(mapping_path);
+
+  std::string cache_key;
+  std::string plans;
+  if (g_plan_cache.enabled()) {
+    cache_key = plan_cache_key(mapping, compile_options);
+    if (g_plan_cache.get(cache_key, plans)) {
+      return plans;
+    }
+  }
+
+  // Parse & validate
+  RDFParser parser;
+  std::vector<NTriple> triples = parser.parse(mapping);
+  rml_normalizer::validator(triples);
+
+  // Rewrite & normalize
+  std::vector<std::vector<NTriple>> sub_graphs = rml_normalizer::normalize_mapping(triples, compile_options.bn_number);
+  triples.clear();
+
+  // Taken before the conversion, so files changed meanwhile invalidate the entry
+  std::map<std::string, PlanDependency> dependencies;
+  if (!cache_key.empty()) {
+    add_plan_dependencies(sub_graphs, compile_options, dependencies);
+  }
+
+  // Logical plan generation, in the same order as the text interface
+  ra_converter::sort_sub_graphs(sub_graphs);
+  plans = ra_converter::convert_sub_graphs(sub_graphs, compile_options.num_threads);
+  ra_converter::save_caches();
+
+  if (!cache_key.empty()) {
+    g_plan_cache.put(cache_key, plans, get_dependency_list(dependencies));
+  }
+  return plans;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Streaming pipeline
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Subgraphs passed from the normalizing to the converting thread
+class SubGraphQueue {
+ private:
+  std::mutex mutex;
+  std::condition_variable available;
+  std::vector<std::vector<NTriple>> sub_graphs;
+  bool closed = false;
+
+ public:
+  void push(std::vector<std::vector<NTriple>>&& more) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& sub_graph : more) {
+        sub_graphs.push_back(std::move(sub_graph));
+      }
+    }
+    available.notify_one();
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    available.notify_one();
+  }
+
+  // Blocks until subgraphs are queued and takes all of them. Returns false
+  // once the queue is closed and empty.
+  bool take_all(std::vector<std::vector<NTriple>>& taken) {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this] { return !sub_graphs.empty() || closed; });
+    taken = std::move(sub_graphs);
+    sub_graphs.clear();
+    return !taken.empty();
+  }
+};
+
+void compile_mapping_stream(const std::string& mapping_path, const CompileOptions& compile_options,
+                            const PlanCallback& emit) {
+  std::string mapping = read_mapping_file(mapping_path);
+
+  // Streamed plans are grouped differently, so they are cached separately
+  std::string cache_key;
+  std::string plans;
+  if (g_plan_cache.enabled()) {
+    CompileOptions cache_options = compile_options;
+    cache_options.plan_options += "stream=true\n";
+    cache_key = plan_cache_key(mapping, cache_options);
+    if (g_plan_cache.get(cache_key, plans)) {
+      emit(plans);
+      return;
+    }
+  }
+
+  // Parse & validate, invalid mappings fail before any plan is emitted
+  RDFParser parser;
+  std::vector<NTriple> triples = parser.parse(mapping);
+  rml_normalizer::validator(triples);
+  std::vector<TriplesMapInput> inputs = partition_mapping(triples);
+
+  // Rewrite & normalize one triples map at a time
+  SubGraphQueue queue;
+  std::atomic<bool> cancelled{false};
+  std::exception_ptr normalizer_error;
+  std::thread normalizer([&]() {
+    try {
+      for (const auto& input : inputs) {
+        if (cancelled) {
+          break;
+        }
+        queue.push(normalize_triples_map(triples, input, compile_options.bn_number));
+      }
+    } catch (...) {
+      normalizer_error = std::current_exception();
+    }
+    queue.close();
+  });
+
+  // Logical plan generation of everything normalized since the last conversion
+  std::map<std::string, PlanDependency> dependencies;
+  try {
+    std::vector<std::vector<NTriple>> sub_graphs;
+    while (queue.take_all(sub_graphs)) {
+      if (!cache_key.empty()) {
+        add_plan_dependencies(sub_graphs, compile_options, dependencies);
+      }
+
+      ra_converter::sort_sub_graphs(sub_graphs);
+      std::string converted = ra_converter::convert_sub_graphs(sub_graphs, compile_options.num_threads);
+      if (!converted.empty()) {
+        emit(converted);
+        plans += converted;
+      }
+    }
+  } catch (...) {
+    cancelled = true;
+    normalizer.join();
+    throw;
+  }
+  normalizer.join();
+  if (normalizer_error) {
+    std::rethrow_exception(normalizer_error);
+  }
+  ra_converter::save_caches();
+
+  if (!cache_key.empty()) {
+    g_plan_cache.put(cache_key, plans, get_dependency_list(dependencies));
+  }
+}
+
+}  // namespace rml_compiler
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" {
+
+const char* rml_compile(const char* mapping_path, const char* options) {
+  using namespace rml_compiler;
+
+  g_result_str.clear();
+  try {
+    CompileOptions compile_options;
+    apply_options(options == nullptr ? "" : options, compile_options);
+    g_result_str = compile_mapping(mapping_path, compile_options);
+  } catch (const std::exception& e) {
+    g_result_str = "Error: " + std::string(e.what());
+  }
+
+  // Return result as a C-string
+  return g_result_str.c_str();
+}
+
+const char* rml_compile_stream(const char* mapping_path, const char* options, void (*emit)(const char* plans)) {
+  using namespace rml_compiler;
+
+  g_result_str.clear();
+  try {
+    CompileOptions compile_options;
+    apply_options(options == nullptr ? "" : options, compile_options);
+    compile_mapping_stream(mapping_path, compile_options, [emit](const std::string& plans) { emit(plans.c_str()); });
+  } catch (const std::exception& e) {
+    g_result_str = "Error: " + std::string(e.what());
+  }
+
+  // Return result as a C-string
+  return g_result_str.c_str();
+}
+
+}  // extern "C"
@@ -0,0 +1,59 @@
+#ifndef RML_COMPILER_H
+#define RML_COMPILER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rml_compiler {
+
+// Options of the pipeline itself, all other options are passed to the converter
+struct CompileOptions {
+  int bn_number = 58932;        // first number of blank nodes generated by the normalizer
+  unsigned int num_threads = 0;  // converter threads, 0 uses all cores
+  std::string plan_options;      // applied options that change the plans, part of the plan cache key
+  std::vector<std::string> dependencies;  // files read by the converter besides the sources
+};
+
+// Applies options given as "key=value" lines. The plan_cache option sets the
+// directory of cached plans, an empty value disables the cache.
+// Throws std::invalid_argument for unknown options and invalid values.
+void apply_options(const std::string& options, CompileOptions& compile_options);
+
+// Restores the default converter options and disables the plan cache. The
+// paths of the converter caches are kept, so their contents stay loaded.
+void reset_options();
+
+// Throws std::runtime_error if the file cannot be read
+std::string read_mapping_file(const std::string& mapping_path);
+
+// Parses, validates, normalizes and converts a mapping file in one address space
+// and returns its plans, one per line. Plans of a mapping compiled before with
+// the same options are taken from the plan cache if none of the files they
+// depend on changed. Throws std::exception on invalid mappings.
+std::string compile_mapping(const std::string& mapping_path, const CompileOptions& compile_options);
+
+// Receives the plans converted together, one per line
+using PlanCallback = std::function<void(const std::string& plans)>;
+
+// Compiles a mapping file like compile_mapping, but passes the plans to emit
+// while the mapping is still compiled. The triples maps are normalized one at
+// a time, and the subgraphs normalized meanwhile are converted while the next
+// triples maps are normalized. Plan groups and cost ordering only span the
+// subgraphs converted together. emit is called on the calling thread, also
+// before an exception for a triples map that cannot be normalized.
+void compile_mapping_stream(const std::string& mapping_path, const CompileOptions& compile_options,
+                            const PlanCallback& emit);
+
+}  // namespace rml_compiler
+
+extern "C" {
+// Returns the plans of a mapping file, or "Error: ..." if it cannot be compiled
+const char* rml_compile(const char* mapping_path, const char* options);
+
+// Passes the plans of a mapping file to emit while it is compiled, see
+// compile_mapping_stream. Returns "" or "Error: ..." if it cannot be compiled.
+const char* rml_compile_stream(const char* mapping_path, const char* options, void (*emit)(const char* plans));
+}  // extern "C"
+
+#endif
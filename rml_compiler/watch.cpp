@@ -0,0 +1,177 @@
+#include "watch.h"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "incremental_compiler.h"
+
+namespace rml_compiler {
+
+// Time to wait for further events after a change, editors often write a file in several steps
+const int settle_ms = 20;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// File watches
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Watches the directories of a set of files, so files replaced by a rename are noticed
+class FileWatches {
+ private:
+  int fd;
+  std::unordered_map<int, std::string> directories;  // watch descriptor -> directory
+  std::unordered_set<std::string> files;
+
+ public:
+  FileWatches() : fd(inotify_init1(IN_CLOEXEC)) {}
+  ~FileWatches() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  bool valid() const { return fd >= 0; }
+
+  void add(const std::string& file) {
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::absolute(file, ec).lexically_normal();
+    if (!files.insert(path.string()).second) {
+      return;
+    }
+
+    std::string directory = path.parent_path().string();
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+    if (wd < 0) {
+      std::cerr << "Warning: Cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+      return;
+    }
+    directories[wd] = directory;
+  }
+
+  // Blocks until a watched file changed, returns false on errors
+  bool wait() {
+    bool changed = false;
+    int timeout = -1;
+    while (true) {
+      pollfd poll_fd{fd, POLLIN, 0};
+      int ready = poll(&poll_fd, 1, timeout);
+      if (ready < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      if (ready == 0) {
+        return true;  // settled
+      }
+
+      alignas(inotify_event) char buffer[64 * 1024];
+      ssize_t length = read(fd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        if (length < 0 && errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+
+      for (char* pos = buffer; pos < buffer + length;) {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(pos);
+        auto it = directories.find(event->wd);
+        if (it != directories.end() && event->len > 0 &&
+            files.contains((std::filesystem::path(it->second) / event->name).string())) {
+          changed = true;
+        }
+        pos += sizeof(inotify_event) + event->len;
+      }
+
+      if (changed) {
+        timeout = settle_ms;
+      }
+    }
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Watch mode
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool write_plan_file(const std::string& plan_path, const std::string& plans) {
+  std::string tmp_path = plan_path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!(file << plans)) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, plan_path, ec);
+  return !ec;
+}
+
+int watch_mapping(const std::string& mapping_path, const CompileOptions& compile_options, const std::string& plan_path) {
+  FileWatches watches;
+  if (!watches.valid()) {
+    std::cerr << "Error: Cannot watch files: " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+  watches.add(mapping_path);
+
+  IncrementalCompiler compiler(mapping_path, compile_options);
+  std::unordered_set<std::string> emitted;
+
+  do {
+    auto start_time = std::chrono::steady_clock::now();
+    std::string plans;
+    try {
+      plans = compiler.compile();
+    } catch (const std::exception& e) {
+      // An invalid edit keeps the plans of the last valid mapping and the watch
+      std::cerr << "Error: " << e.what() << std::endl;
+      if (!plan_path.empty()) {
+        std::cerr << "Kept the previous plans in " << plan_path << "." << std::endl;
+      }
+      continue;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    for (const auto& source : compiler.get_sources()) {
+      watches.add(source);
+    }
+    if (!plan_path.empty() && !write_plan_file(plan_path, plans)) {
+      std::cerr << "Error: Could not write file: " << plan_path << std::endl;
+    }
+
+    // Emit the plans that are new since the previous compilation
+    std::unordered_set<std::string> current;
+    std::istringstream stream(plans);
+    std::string plan;
+    while (std::getline(stream, plan)) {
+      if (!plan.empty() && current.insert(plan).second && !emitted.contains(plan)) {
+        std::cout << plan << "\n";
+      }
+    }
+    std::cout.flush();
+    emitted = std::move(current);
+
+    const CompileStatistics& statistics = compiler.get_statistics();
+    std::cerr << "Compiled in " << std::llround(ms) << " ms: " << statistics.normalized << " of "
+              << statistics.triples_maps << " triples maps normalized, " << statistics.converted << " of "
+              << statistics.plans << " plans converted." << std::endl;
+  } while (watches.wait());
+
+  std::cerr << "Error: Lost the file watches: " << std::strerror(errno) << std::endl;
+  return 1;
+}
+
+}  // namespace rml_compiler
@@ -0,0 +1,19 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <string>
+
+#include "rml_compiler.h"
+
+namespace rml_compiler {
+
+// Compiles the mapping incrementally whenever the mapping file or one of its
+// sources changes, until the process is terminated. The plans are written to
+// plan_path if it is not empty, the plans that are new since the previous
+// compilation are printed to stdout and a summary of each compilation to stderr.
+// Returns 1 if the files cannot be watched.
+int watch_mapping(const std::string& mapping_path, const CompileOptions& compile_options, const std::string& plan_path);
+
+}  // namespace rml_compiler
+
+#endif
@@ -1,10 +1,20 @@
 import ctypes
 import os
 import argparse
+import queue
+import socket
 import sys
+import threading
 import time
 
-from backend.konverter import run_converter
+try:
+    from backend.konverter import run_converter
+except ImportError:
+    # Not needed when the plans are run by the reference executor
+    run_converter = None
+
+# Receives the plans converted together by rml_compile_stream
+PLAN_CALLBACK = ctypes.CFUNCTYPE(None, ctypes.c_char_p)
 
 class Configuration:
     def __init__(self):
@@ -15,115 +25,266 @@ class Configuration:
         self.threading_enabled = "true"
         self.materialize_constants = "true"
         self.heuristic_ordering = "true"
+        # Operators and annotations beyond the konverter grammar, which only the
+        # reference executor is known to accept. Without them, the rewrites that
+        # emit them are off, e.g. constant plans, null filters and shared joins.
+        self.extended_grammar = "false"
+        self.constant_plans = "true"
+        self.push_null_filters = "true"
+        self.early_distinct = "true"
+        self.unique_keys = []
+        self.statistics = "true"
+        self.join_hints = "true"
+        self.broadcast_threshold = str(64 * 1024 * 1024)
+        self.split_size = str(128 * 1024 * 1024)
+        self.plan_templates = "true"
+        self.validate_references = "true"
+        self.share_joins = "true"
+        self.late_materialization = "false"
+        self.semi_join_reduction = "true"
+        self.semi_join_threshold = "0.5"
+        self.cost_ordering = "true"
+        self.profile = "false"
+        self.plan_cache = "true"
+        self.stream = "false"
+        self.compile_socket = ""
+        self.cache_dir = os.path.join(os.path.expanduser("~"), ".cache", "rml_frontend")
         self.bn_number = 58932
-        self.lib_rml_parser = self.load_rml_parser()
-        self.lib_rml_io_normalizer = self.load_rml_io_normalizer()
-        self.lib_ra_converter = self.load_ra_converter()
-
-    def load_rml_parser(self):
+        self.executor = "konverter"
+        self._lib_rml_compiler = None
+        self._lib_ra_executor = None
+
+    @property
+    def lib_rml_compiler(self):
+        # Loaded on first use, compiling with the daemon does not need it
+        if self._lib_rml_compiler is None:
+            self._lib_rml_compiler = self.load_rml_compiler()
+        return self._lib_rml_compiler
+
+    def load_rml_compiler(self):
         base_path = sys._MEIPASS if getattr(sys, 'frozen', False) else os.path.dirname(__file__)
-        lib_path = os.path.join(base_path, "librdfparser.so")
+        lib_path = os.path.join(base_path, "librmlcompiler.so")
 
         try:
             lib = ctypes.CDLL(lib_path)
-            lib.parse_rdf.argtypes = [ctypes.c_char_p]
-            lib.parse_rdf.restype = ctypes.c_char_p
+            lib.rml_compile.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+            lib.rml_compile.restype = ctypes.c_char_p
+            lib.rml_compile_stream.argtypes = [ctypes.c_char_p, ctypes.c_char_p, PLAN_CALLBACK]
+            lib.rml_compile_stream.restype = ctypes.c_char_p
+            lib.set_converter_option.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+            lib.set_converter_option.restype = ctypes.c_int
+            lib.record_plan_profile.argtypes = [ctypes.c_char_p, ctypes.c_double, ctypes.c_longlong]
+            lib.record_plan_profile.restype = None
+            lib.save_plan_profile.argtypes = []
+            lib.save_plan_profile.restype = None
             return lib
         except OSError as e:
-            print(f"Error loading 'librdfparser.so': {e}")
+            print(f"Error loading 'librmlcompiler.so': {e}")
             sys.exit(1)
 
-    def load_rml_io_normalizer(self):
-        base_path = sys._MEIPASS if getattr(sys, 'frozen', False) else os.path.dirname(__file__)
-        lib_path = os.path.join(base_path, "libnormalizer.so")
+    @property
+    def lib_ra_executor(self):
+        if self._lib_ra_executor is None:
+            self._lib_ra_executor = self.load_ra_executor()
+        return self._lib_ra_executor
 
-        try:
-            lib = ctypes.CDLL(lib_path)
-            lib.normalize_rml_mapping.argtypes = [ctypes.c_char_p, ctypes.c_int]
-            lib.normalize_rml_mapping.restype = ctypes.c_char_p
-            return lib
-        except OSError as e:
-            print(f"Error loading 'libnormalizer.so': {e}")
-            sys.exit(1)
-
-    def load_ra_converter(self):
+    def load_ra_executor(self):
         base_path = sys._MEIPASS if getattr(sys, 'frozen', False) else os.path.dirname(__file__)
-        lib_path = os.path.join(base_path, "libraconverter.so")
+        lib_path = os.path.join(base_path, "libraexecutor.so")
 
         try:
             lib = ctypes.CDLL(lib_path)
-            lib.create_relational_algebra.argtypes = [ctypes.c_char_p]
-            lib.create_relational_algebra.restype = ctypes.c_char_p
+            lib.run_plans.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+            lib.run_plans.restype = ctypes.c_char_p
             return lib
         except OSError as e:
-            print(f"Error loading 'libraconverter.so': {e}")
+            print(f"Error loading 'libraexecutor.so': {e}")
             sys.exit(1)
 
 ####################################################################################################################
 
-def load_rml(file_path, config):
+def compiler_options(config):
+    return {
+        "bn_number": str(config.bn_number),
+        # 0 threads uses all cores
+        "threads": "0" if config.threading_enabled == "true" else "1",
+        "extended_grammar": config.extended_grammar,
+        "materialize_constants": config.constant_plans,
+        "push_null_filters": config.push_null_filters,
+        "early_distinct": config.early_distinct,
+        "unique_keys": ";".join(config.unique_keys),
+        "statistics": config.statistics,
+        "statistics_catalog": os.path.join(config.cache_dir, "statistics.catalog"),
+        "join_hints": config.join_hints,
+        "broadcast_threshold": config.broadcast_threshold,
+        "split_size": config.split_size,
+        "split_points_cache": os.path.join(config.cache_dir, "split_points.cache"),
+        "group_identical_maps": config.plan_templates,
+        "validate_references": config.validate_references,
+        "share_joins": config.share_joins,
+        "late_materialization": config.late_materialization,
+        "semi_join_reduction": config.semi_join_reduction,
+        "semi_join_threshold": config.semi_join_threshold,
+        "cost_ordering": config.cost_ordering,
+        "plan_profile": os.path.join(config.cache_dir, "plan_profile.tsv"),
+        # Plans are reused while the mapping, these options, the build and the sources are unchanged
+        "plan_cache": os.path.join(config.cache_dir, "plans") if config.plan_cache == "true" else "",
+    }
+
+def request_compile(options, config, on_chunk=None):
+    # Sends the request to the daemon started with "rml_compile --daemon", relative
+    # paths are resolved against our working directory. Streamed answers are
+    # passed to on_chunk as they arrive.
+    request = f"mapping={os.path.abspath(config.mapping_file_path)}\ncwd={os.getcwd()}\n{options}"
+
     try:
-        file_path = file_path.encode()
-        lib = config.lib_rml_parser
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as client:
+            client.connect(config.compile_socket)
+            client.sendall(request.encode())
+            client.shutdown(socket.SHUT_WR)
+
+            chunks = []
+            while chunk := client.recv(64 * 1024):
+                if on_chunk is not None:
+                    on_chunk(chunk)
+                chunks.append(chunk)
+    except OSError as e:
+        print(f"Error: Could not reach the compile daemon at '{config.compile_socket}': {e}")
+        sys.exit(1)
+
+    return b"".join(chunks).decode()
 
-        result = lib.parse_rdf(file_path)
+def compile_mapping(config):
+    # Parse, validate, normalize and convert in a single call
+    options = "".join(f"{key}={value}\n" for key, value in compiler_options(config).items())
+
+    if config.compile_socket:
+        ra_str = request_compile(options, config)
+    else:
+        lib = config.lib_rml_compiler
+        result = lib.rml_compile(config.mapping_file_path.encode(), options.encode())
 
         if result is None:
-            print("RDF parser function returned NULL or encountered an error")
+            print("Error: Function returned NULL")
             sys.exit(1)
 
-        result_str = result.decode()
-        if result_str.startswith("Error:"):
-            print(result_str)
-            sys.exit(1)
+        ra_str = result.decode()
 
-        return result_str
-    except OSError as e:
-        print(f"Failed to load library: {e}")
-        sys.exit(1)
-    except Exception as e:
-        print(f"Unexpected error: {e}")
+    if ra_str.startswith("Error:"):
+        print(ra_str)
         sys.exit(1)
 
-def normalize_mapping(rml_str, config):
-    rml_str = rml_str.encode()
+    return ra_str
+
+def stream_plans(config, plan_queue):
+    # Puts the plans into the queue while the mapping is compiled, followed by
+    # an error message if it fails and None at the end
+    options = "".join(f"{key}={value}\n" for key, value in compiler_options(config).items())
+
+    if config.compile_socket:
+        # Only complete lines are plans, the last line of a failed compilation is the error
+        pending = b""
+        def on_chunk(chunk):
+            nonlocal pending
+            pending += chunk
+            if pending.startswith(b"Error:"):
+                return
+
+            lines = pending.splitlines(keepends=True)
+            complete = [line for line in lines if line.endswith(b"\n")]
+            for i, line in enumerate(complete):
+                if line.startswith(b"Error:"):
+                    complete = complete[:i]
+                    break
+            plans = b"".join(complete)
+            pending = pending[len(plans):]
+            if plans:
+                plan_queue.put(plans.decode())
+
+        request_compile("stream=true\n" + options, config, on_chunk)
+        if pending:
+            plan_queue.put(pending.decode())
+    else:
+        lib = config.lib_rml_compiler
+        callback = PLAN_CALLBACK(lambda plans: plan_queue.put(plans.decode()))
+        result = lib.rml_compile_stream(config.mapping_file_path.encode(), options.encode(), callback)
 
-    lib = config.lib_rml_io_normalizer
-    result = lib.normalize_rml_mapping(rml_str, config.bn_number)
+        if result is None:
+            plan_queue.put("Error: Function returned NULL")
+        elif result:
+            plan_queue.put(result.decode())
+
+    plan_queue.put(None)
+
+def execute(ra_str, config):
+    # Runs the plans on the konverter backend, or on the reference executor
+    # which appends the quads to the output file and returns their number
+    if config.executor == "reference":
+        result = config.lib_ra_executor.run_plans(ra_str.encode(), config.output_file_path.encode(),
+                                                  config.base_uri.encode(),
+                                                  0 if config.threading_enabled == "true" else 1,
+                                                  1 if config.continue_on_error == "true" else 0).decode()
+        if result.startswith("Error:"):
+            print(result)
+            sys.exit(1)
+        return int(dict(item.split("=") for item in result.split())["triples"])
 
-    if not result:
-        print("Error: Function returned NULL")
+    if run_converter is None:
+        print("Error: The konverter backend was not found, run the plans with --reference-executor instead.")
         sys.exit(1)
+    run_converter(ra_str, config.base_uri, config.continue_on_error, config.threading_enabled,
+                  config.materialize_constants, config.heuristic_ordering)
 
-    normalized_result = result.decode()
-
-    # Separate graphs
-    normalized_graphs = []
-    for sub_graph in normalized_result.split("===="):
-        sub_graph = sub_graph.strip()
-        if sub_graph == "":
+def run_streamed(config, start_time):
+    # Executes the plans converted so far while the rest of the mapping is
+    # compiled, the plans that arrive meanwhile are executed together. Only the
+    # reference executor appends the quads of every batch to the output, the
+    # konverter backend is not given an output path, so it runs all plans in a
+    # single session once the mapping is compiled.
+    plan_queue = queue.Queue()
+    compiler = threading.Thread(target=stream_plans, args=(config, plan_queue), daemon=True)
+    compiler.start()
+
+    ra_str = ""
+    finished = False
+    while not finished:
+        batch = [plan_queue.get()]
+        while not plan_queue.empty():
+            batch.append(plan_queue.get_nowait())
+
+        for plans in batch:
+            if plans is None:
+                finished = True
+                print("Frontend took:", time.time()-start_time)
+            elif plans.startswith("Error:"):
+                print(plans.strip())
+                sys.exit(1)
+            else:
+                ra_str += plans
+
+        if ra_str and (finished or config.executor == "reference"):
+            execute(ra_str, config)
+            ra_str = ""
+
+def run_profiled(ra_str, config):
+    # Runs the plans one at a time on the reference executor, which reports the
+    # triples of every plan. The konverter backend is not given an output file,
+    # so neither its triples per plan nor its output of separate runs are known.
+    lib = config.lib_rml_compiler
+    # Not set yet if the mapping was compiled by the daemon
+    lib.set_converter_option(b"plan_profile", compiler_options(config)["plan_profile"].encode())
+
+    for plan in ra_str.splitlines():
+        if not plan:
             continue
-        normalized_graphs.append(sub_graph)
-
-    return normalized_graphs
-
-def convert_to_ra(normalized_graphs_arr, config):
-    ra_expressions = []
-    for normalized_graph in normalized_graphs_arr:
-        normalized_graph = normalized_graph.encode()
 
-        lib = config.lib_ra_converter
-        results = lib.create_relational_algebra(normalized_graph)
+        start_time = time.time()
+        triples = execute(plan + "\n", config)
+        seconds = time.time() - start_time
 
-        results = results.decode()
+        lib.record_plan_profile(plan.encode(), seconds, triples)
 
-        results_split = results.strip().split("\n")
-        results_split = [item for item in results_split if item] # Remove empty strings ""
-
-        for result in results_split:
-            ra_expressions.append(result)
-
-    return ra_expressions
+    lib.save_plan_profile()
 
 ####################################################################################################################
 
@@ -136,6 +297,28 @@ def handle_cli(config):
     parser.add_argument("--no-threading", action='store_false', help="Disables multithreading during execution.")
     parser.add_argument("--no-const-folding", action='store_false', help="Disables constant folding optimization.")
     parser.add_argument("--no-ordering", action='store_false', help="Disables heuristic ordering optimization.")
+    parser.add_argument("--extended-grammar", action='store_true', help="Emits plan operators and annotations beyond the konverter grammar, which enables the plan rewrites that need them. Implied by --reference-executor.")
+    parser.add_argument("--no-constant-plans", action='store_false', help="Disables folding constant term maps into bind[] nodes of the plans.")
+    parser.add_argument("--no-null-filters", action='store_false', help="Disables null filter pushdown below joins and creates.")
+    parser.add_argument("--no-early-distinct", action='store_false', help="Disables duplicate elimination on the parent side of joins.")
+    parser.add_argument("--no-statistics", action='store_false', help="Disables sampling of sources for cardinality estimates.")
+    parser.add_argument("--no-join-hints", action='store_false', help="Disables physical join strategy hints.")
+    parser.add_argument("--broadcast-threshold", type=int, required=False, help="The maximum size in bytes of a broadcast join input.")
+    parser.add_argument("--split-size", type=int, required=False, help="The target size in bytes of parallel range scans, 0 disables splitting.")
+    parser.add_argument("--no-plan-templates", action='store_false', help="Disables sharing one plan between triples maps that only differ in their source.")
+    parser.add_argument("--no-reference-validation", action='store_false', help="Disables checking referenced attributes against the CSV source headers.")
+    parser.add_argument("--no-join-sharing", action='store_false', help="Disables sharing one join between predicate object maps with the same parent join.")
+    parser.add_argument("--late-materialization", action='store_true', help="Joins parent sources on keys and row IDs and fetches the other attributes after the join.")
+    parser.add_argument("--no-semi-join", action='store_false', help="Disables the reduction of parent sources to the rows matching a child key.")
+    parser.add_argument("--semi-join-threshold", type=float, required=False, help="The maximum estimated fraction of parent rows kept by a semi-join reduction.")
+    parser.add_argument("--no-cost-ordering", action='store_false', help="Emits the plans in mapping order instead of largest estimated cost first.")
+    parser.add_argument("--profile", action='store_true', help="Runs the plans one at a time with the reference executor and records their execution times for the plan ordering of later runs.")
+    parser.add_argument("--no-plan-cache", action='store_false', help="Disables reusing the plans of a previous run with the same mapping, options and sources.")
+    parser.add_argument("--stream", action='store_true', help="Experimental: Compiles the mapping in batches, plans are only grouped and ordered among those compiled together. The reference executor runs every batch as soon as it is compiled, the konverter backend runs all of them at the end.")
+    parser.add_argument("--compile-socket", type=str, required=False, help="Compiles the mapping with the daemon listening on this Unix socket, see 'rml_compile --daemon'.")
+    parser.add_argument("--cache-dir", type=str, required=False, help="The directory where statistics and caches are stored.")
+    parser.add_argument("--reference-executor", action='store_true', help="Runs the plans with the in-process reference executor instead of the konverter backend, e.g. to check plan rewrites.")
+    parser.add_argument("--unique-key", type=str, action='append', default=[], metavar="SOURCE:ATTRIBUTE", help="Declares an attribute as unique key of a source.")
 
 
     args = parser.parse_args()
@@ -156,19 +339,80 @@ def handle_cli(config):
     if args.no_const_folding == False:
         config.materialize_constants = str(args.no_const_folding).lower()
 
+    if args.extended_grammar:
+        config.extended_grammar = str(args.extended_grammar).lower()
+
+    if args.no_constant_plans == False:
+        config.constant_plans = str(args.no_constant_plans).lower()
+
     if args.no_ordering == False:
         config.heuristic_ordering = str(args.no_const_folding).lower()
 
+    if args.no_null_filters == False:
+        config.push_null_filters = str(args.no_null_filters).lower()
 
-####################################################################################################################
+    if args.no_early_distinct == False:
+        config.early_distinct = str(args.no_early_distinct).lower()
+
+    config.unique_keys = args.unique_key
+
+    if args.no_statistics == False:
+        config.statistics = str(args.no_statistics).lower()
+
+    if args.no_join_hints == False:
+        config.join_hints = str(args.no_join_hints).lower()
+
+    if args.broadcast_threshold is not None:
+        config.broadcast_threshold = str(args.broadcast_threshold)
+
+    if args.split_size is not None:
+        config.split_size = str(args.split_size)
+
+    if args.no_plan_templates == False:
+        config.plan_templates = str(args.no_plan_templates).lower()
+
+    if args.no_reference_validation == False:
+        config.validate_references = str(args.no_reference_validation).lower()
+
+    if args.no_join_sharing == False:
+        config.share_joins = str(args.no_join_sharing).lower()
+
+    if args.late_materialization:
+        config.late_materialization = str(args.late_materialization).lower()
+
+    if args.no_semi_join == False:
+        config.semi_join_reduction = str(args.no_semi_join).lower()
+
+    if args.semi_join_threshold is not None:
+        config.semi_join_threshold = str(args.semi_join_threshold)
 
-def to_ra_string(ra_expressions):
-    res = ""
-    for ra_expression in ra_expressions:
-        res += ra_expression + "\n"
+    if args.no_cost_ordering == False:
+        config.cost_ordering = str(args.no_cost_ordering).lower()
 
-    res.strip()
-    return res
+    if args.profile:
+        config.profile = str(args.profile).lower()
+
+    if args.no_plan_cache == False:
+        config.plan_cache = str(args.no_plan_cache).lower()
+
+    if args.stream:
+        config.stream = str(args.stream).lower()
+
+    if args.compile_socket:
+        config.compile_socket = args.compile_socket
+
+    if args.cache_dir:
+        config.cache_dir = args.cache_dir
+
+    if args.reference_executor:
+        config.executor = "reference"
+        config.extended_grammar = "true"
+
+    if args.profile and not args.reference_executor:
+        parser.error("--profile needs --reference-executor, the konverter backend does not report the triples of a plan")
+
+
+####################################################################################################################
 
 def main():
     start_time = time.time()
@@ -177,22 +421,25 @@ def main():
     config = Configuration()
     handle_cli(config)
 
-    ### STEP 1: Parse & Validate ###
-    rml_str = load_rml(config.mapping_file_path, config)
-    
-    ### STEP 2: Rewrite & Normalize ###
-    normalized_graphs_arr = normalize_mapping(rml_str, config)
-    normalized_graphs_arr.sort()
-    
-    ### STEP 3: Logical plan generation
-    ra_expressions = convert_to_ra(normalized_graphs_arr, config)
+    # The reference executor appends the quads of every batch of plans, the
+    # output of previous runs is dropped once here
+    if config.executor == "reference":
+        open(config.output_file_path, "w").close()
+
+    # Profiling runs the plans one at a time, after the complete compilation
+    if config.stream == "true" and config.profile != "true":
+        run_streamed(config, start_time)
+        return
 
-    ra_str = to_ra_string(ra_expressions)
+    ### Parse & Validate, Rewrite & Normalize, Logical plan generation ###
+    ra_str = compile_mapping(config)
 
     print("Frontend took:", time.time()-start_time)
 
-    run_converter(ra_str, config.base_uri, config.continue_on_error, config.threading_enabled, 
-                  config.materialize_constants, config.heuristic_ordering)
+    if config.profile == "true":
+        run_profiled(ra_str, config)
+    else:
+        execute(ra_str, config)
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
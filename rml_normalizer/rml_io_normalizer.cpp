@@ -1,29 +1,22 @@
+#include "rml_io_normalizer.h"
+
 #include <algorithm>
 #include <format>
 #include <iostream>
 #include <sstream>
 #include <stack>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+namespace rml_normalizer {
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////// Definitions
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-struct NTriple {
-  std::string subject;
-  std::string predicate;
-  std::string object;
-
-  bool operator==(const NTriple& other) const {
-    return subject == other.subject &&
-           predicate == other.predicate &&
-           object == other.object;
-  }
-};
-
 // used to store string result
 static std::string g_result_str;
 
@@ -92,8 +85,7 @@ std::vector<std::string> extract_triple_map_nodes(const std::vector<NTriple>& tr
   }
 
   if (triple_maps.size() == 0) {
-    std::cout << "No TMs found." << std::endl;
-    std::exit(1);
+    throw std::runtime_error("No TMs found.");
   }
 
   return triple_maps;
@@ -558,9 +550,9 @@ std::vector<NTriple> generate_subgraph(const std::vector<NTriple>& triples, cons
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<std::vector<NTriple>> separate_triple_maps(const std::vector<std::string>& triple_maps, const std::vector<NTriple>& triples) {
-  std::vector<std::vector<NTriple>> rdfSubGraphs;
-
+// Passes the subgraph of every complete TriplesMap to emit as soon as it is generated
+void separate_triple_maps(const std::vector<std::string>& triple_maps, const std::vector<NTriple>& triples,
+                          const SubGraphCallback& emit) {
   // Iterate over each TriplesMap identifier
   for (const auto& tm : triple_maps) {
     // Generate the subgraph starting from this TriplesMap
@@ -601,11 +593,9 @@ std::vector<std::vector<NTriple>> separate_triple_maps(const std::vector<std::st
 
     // Only add the subgraph if all required maps are found.
     if (found_subjectMap && found_predicateMap && found_objectMap) {
-      rdfSubGraphs.push_back(sub_g);
+      emit(std::move(sub_g));
     }
   }
-
-  return rdfSubGraphs;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -656,7 +646,7 @@ std::string rdf_string_to_vector(const std::vector<NTriple>& triples) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<std::vector<NTriple>> normalize_mapping(const std::vector<NTriple>& rml_vector, const int& init_bnode_counter) {
+void normalize_mapping(const std::vector<NTriple>& rml_vector, const int& init_bnode_counter, const SubGraphCallback& emit) {
   int bnode_counter = init_bnode_counter;
 
   const std::vector<NTriple> rml_vector_expanded_classes = expand_classes(rml_vector, bnode_counter);
@@ -665,28 +655,33 @@ std::vector<std::vector<NTriple>> normalize_mapping(const std::vector<NTriple>&
   const std::vector<NTriple> rml_vector_separated_poms = separate_predicate_object_maps(rml_vector_expanded_poms);
 
   const std::vector<std::string> triple_maps = extract_triple_map_nodes(rml_vector_separated_poms);
-  const std::vector<std::vector<NTriple>> rml_sub_graphs = separate_triple_maps(triple_maps, rml_vector_separated_poms);
+  separate_triple_maps(triple_maps, rml_vector_separated_poms, emit);
+}
 
+std::vector<std::vector<NTriple>> normalize_mapping(const std::vector<NTriple>& rml_vector, const int& init_bnode_counter) {
+  std::vector<std::vector<NTriple>> rml_sub_graphs;
+  normalize_mapping(rml_vector, init_bnode_counter,
+                    [&](std::vector<NTriple>&& sub_graph) { rml_sub_graphs.push_back(std::move(sub_graph)); });
   return rml_sub_graphs;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void validator(const std::vector<NTriple> &rdf_vector){
+  // Count the subject maps of every node once, instead of per TriplesMap
+  std::unordered_map<std::string, int> subject_map_counts;
+  for (const auto& triple : rdf_vector){
+    if (triple.predicate == "http://www.w3.org/ns/r2rml#subjectMap"){
+      subject_map_counts[triple.subject]++;
+    }
+  }
+
   // Check for multiple subject maps
-  int tm_cnt = 0;
   for (const auto& triple : rdf_vector){
     if (triple.predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#type" && triple.object == "http://www.w3.org/ns/r2rml#TriplesMap"){
-      for (const auto& triple2: rdf_vector){
-        if (triple2.subject == triple.subject && triple2.predicate == "http://www.w3.org/ns/r2rml#subjectMap" ){
-          tm_cnt++;
-        }
-      }
-      if (tm_cnt > 1){
-        std::cout << "Error: Found multiple subject maps!" << std::endl;
-        std::exit(1);
+      if (subject_map_counts[triple.subject] > 1){
+        throw std::runtime_error("Found multiple subject maps!");
       }
-      tm_cnt = 0;
     }
   }
 
@@ -701,21 +696,27 @@ const char* normalize_rml_mapping(const char* input_rdf_mapping, int bn_number)
   std::string rdf_rule_str(input_rdf_mapping);
   std::vector<NTriple> rdf_vector = rdf_string_to_vector(rdf_rule_str);
 
-  // Validate
-  validator(rdf_vector);
+  g_result_str.clear();
+  try {
+    // Validate
+    validator(rdf_vector);
 
-  //  Normalize
-  std::vector<std::vector<NTriple>> normalized_graphs = normalize_mapping(rdf_vector, bn_number);
+    //  Normalize
+    std::vector<std::vector<NTriple>> normalized_graphs = normalize_mapping(rdf_vector, bn_number);
 
-  g_result_str.clear();
-  // Transform vectors to one string
-  for (const auto& normalized_graph : normalized_graphs) {
-    std::string normalized_graph_str = rdf_string_to_vector(normalized_graph);
-    g_result_str += normalized_graph_str;
-    g_result_str += "====";
+    // Transform vectors to one string
+    for (const auto& normalized_graph : normalized_graphs) {
+      std::string normalized_graph_str = rdf_string_to_vector(normalized_graph);
+      g_result_str += normalized_graph_str;
+      g_result_str += "====";
+    }
+  } catch (const std::exception& e) {
+    g_result_str = "Error: " + std::string(e.what());
   }
 
   // Return result as a C-string
   return g_result_str.c_str();
 }
-}
\ No newline at end of file
+}  // extern "C"
+
+}  // namespace rml_normalizer
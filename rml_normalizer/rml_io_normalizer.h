@@ -0,0 +1,35 @@
+#ifndef RML_IO_NORMALIZER_H
+#define RML_IO_NORMALIZER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../rdf_parser/definitions.h"
+
+namespace rml_normalizer {
+
+// Throws std::runtime_error if the mapping is invalid
+void validator(const std::vector<NTriple>& rdf_vector);
+
+using SubGraphCallback = std::function<void(std::vector<NTriple>&&)>;
+
+// Rewrites the mapping into one subgraph per triples map and predicate object map,
+// new blank nodes are numbered from init_bnode_counter
+std::vector<std::vector<NTriple>> normalize_mapping(const std::vector<NTriple>& rml_vector, const int& init_bnode_counter);
+
+// Same as above, but passes every subgraph to emit as soon as it is separated
+void normalize_mapping(const std::vector<NTriple>& rml_vector, const int& init_bnode_counter, const SubGraphCallback& emit);
+
+// The passes of normalize_mapping in the order it applies them, exposed for the stage benchmarks
+std::vector<NTriple> expand_classes(const std::vector<NTriple>& input_triples, int& bn_counter);
+std::vector<NTriple> expand_constants(const std::vector<NTriple>& input_triples, int& bn_counter);
+std::vector<NTriple> expand_predicate_object_maps(const std::vector<NTriple>& input_triples, int& bn_counter);
+std::vector<NTriple> separate_predicate_object_maps(const std::vector<NTriple>& input_triples);
+std::vector<std::string> extract_triple_map_nodes(const std::vector<NTriple>& triples);
+void separate_triple_maps(const std::vector<std::string>& triple_maps, const std::vector<NTriple>& triples,
+                          const SubGraphCallback& emit);
+
+}  // namespace rml_normalizer
+
+#endif